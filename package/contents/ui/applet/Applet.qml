@@ -1,4 +1,5 @@
 import QtQuick 2.7
+import QtQuick.Window 2.2
 
 import org.kde.kquickcontrolsaddons 2.0
 import org.kde.plasma.core 2.0 as PlasmaCore
@@ -24,22 +25,56 @@ Item {
     VirtualDesktopBar {
         id: backend
 
+        screenGeometry: plasmoid.screenGeometry
+        cacheName: "applet-" + plasmoid.id
+        // Labels are measured in bold whenever the current one is bold,
+        // so that the common size fits them either way
+        labelFont: Qt.font({
+            family: config.DesktopLabelsCustomFont || theme.defaultFont.family,
+            pixelSize: config.DesktopLabelsCustomFontSize || theme.defaultFont.pixelSize,
+            bold: config.DesktopLabelsBoldFontForCurrentDesktop
+        })
+        cfg_DesktopLabelsStyle: config.DesktopLabelsStyle
+        cfg_DesktopLabelsStyleCustomFormat: config.DesktopLabelsStyleCustomFormat
+        cfg_DesktopLabelsMaximumLength: config.DesktopLabelsMaximumLength
+        cfg_DesktopLabelsDisplayAsUppercased: config.DesktopLabelsDisplayAsUppercased
+
         cfg_EmptyDesktopsRenameAs: config.EmptyDesktopsRenameAs
         cfg_AddingDesktopsExecuteCommand: config.AddingDesktopsExecuteCommand
         cfg_DynamicDesktopsEnable: config.DynamicDesktopsEnable
         cfg_MultipleScreensFilterOccupiedDesktops: config.MultipleScreensFilterOccupiedDesktops
+        cfg_WindowRules: config.WindowRules
+        cfg_RefreshMinimumInterval: config.RefreshMinimumInterval
+        cfg_RefreshMaximumLatency: config.RefreshMaximumLatency
+        cfg_RefreshBudget: config.RefreshBudget
+        cfg_StartupBudget: config.StartupBudget
+        cfg_KWinLatencyBudget: config.KWinLatencyBudget
+        cfg_HooksDesktopAddedCommand: config.HooksDesktopAddedCommand
+        cfg_HooksDesktopRemovedCommand: config.HooksDesktopRemovedCommand
+        cfg_HooksDesktopSwitchedCommand: config.HooksDesktopSwitchedCommand
+        cfg_HooksDesktopBecameEmptyCommand: config.HooksDesktopBecameEmptyCommand
+        cfg_HooksDesktopBecameOccupiedCommand: config.HooksDesktopBecameOccupiedCommand
+    }
+
+    // Durations shown in the overlay are upper bounds in microseconds
+    Loader {
+        active: config.StatisticsShowOverlay && container
+        sourceComponent: StatisticsOverlay {}
     }
 
     Connections {
         target: backend
-        onDesktopInfoListSent: container.update(desktopInfoList)
         onRequestRenameCurrentDesktop: renamePopup.show(container.currentDesktopButton)
+        onDesktopOperationFailed: console.warn("Virtual Desktop Bar: " + operation +
+                                               " of desktop " + number + " failed: " + errorMessage)
     }
 
     Component.onCompleted: {
         Qt.callLater(function() {
             initializeContextMenuActions();
             backend.requestDesktopInfoList();
+            container.desktopButtonsPopulated = true;
+            backend.reportDesktopButtonsPopulated(container.Window.window);
         });
     }
 
@@ -86,6 +121,6 @@ Item {
     }
 
     function action_removeLastDesktop() {
-        backend.removeDesktop(container.lastDesktopButton.number);
+        backend.removeDesktop(container.numberOfDesktopButtons);
     }
 }
@@ -2,6 +2,8 @@ import QtQuick 2.7
 import QtQuick.Controls 1.4
 import QtQuick.Layouts 1.3
 
+import org.kde.plasma.virtualdesktopbar 1.2
+
 import "../common/Utils.js" as Utils
 
 GridLayout {
@@ -11,21 +13,40 @@ GridLayout {
           GridLayout.TopToBottom :
           GridLayout.LeftToRight
 
-    property var desktopButtonList: []
-
     property Item lastHoveredButton
-    property Item lastDesktopButton
     property Item currentDesktopButton
-    property Item largestDesktopButton
-    property int numberOfVisibleDesktopButtons
+    property alias numberOfDesktopButtons: desktopButtonRepeater.count
+
+    property bool desktopButtonsPopulated: false
 
     DesktopButton { id: desktopButtonComponent }
 
-    GridLayout {
+    // Buttons are laid out, filtered and animated by the plugin
+    DesktopButtonStrip {
         id: desktopButtonContainer
-        rowSpacing: parent.rowSpacing
-        columnSpacing: parent.columnSpacing
-        flow: parent.flow
+
+        Layout.fillWidth: isVerticalOrientation
+        Layout.fillHeight: !isVerticalOrientation
+
+        model: backend.desktopListModel
+        vertical: isVerticalOrientation
+        showOnlyCurrent: config.DesktopButtonsShowOnlyForCurrentDesktop
+        showOnlyOccupied: config.DesktopButtonsShowOnlyForOccupiedDesktops
+        animationDuration: config.AnimationsEnable ? 100 : 0
+
+        Repeater {
+            id: desktopButtonRepeater
+            model: backend.desktopListModel
+            delegate: desktopButtonComponent
+
+            onItemAdded: {
+                if (desktopButtonsPopulated && !config.DynamicDesktopsEnable) {
+                    handleAddedDesktopButton(item);
+                }
+            }
+
+            onItemRemoved: handleRemovedDesktopButton(item)
+        }
     }
 
     AddDesktopButton {}
@@ -34,6 +55,7 @@ GridLayout {
 
     property bool isDragging: false
     property Item draggedDesktopButton
+    property int draggedDesktopButtonInitialNumber
 
     MouseArea {
         anchors.fill: parent
@@ -48,7 +70,7 @@ GridLayout {
         }
 
         onPressed: {
-            var initialDesktopButton = desktopButtonContainer.childAt(mouse.x, mouse.y);
+            var initialDesktopButton = desktopButtonContainer.buttonAt(mouse.x, mouse.y);
             if (!initialDesktopButton) {
                 return;
             }
@@ -58,17 +80,18 @@ GridLayout {
                     return;
                 }
 
-                var desktopButton = desktopButtonContainer.childAt(mouse.x, mouse.y);
+                var desktopButton = desktopButtonContainer.buttonAt(mouse.x, mouse.y);
                 if (desktopButton && desktopButton == initialDesktopButton) {
                     isDragging = true;
                     draggedDesktopButton = desktopButton;
+                    draggedDesktopButtonInitialNumber = desktopButton.number;
                 }
             });
         }
 
         onPositionChanged: {
             if (isDragging) {
-                var desktopButton = desktopButtonContainer.childAt(mouse.x, mouse.y);
+                var desktopButton = desktopButtonContainer.buttonAt(mouse.x, mouse.y);
 
                 if (desktopButton) {
                     if (desktopButton != draggedDesktopButton) {
@@ -80,8 +103,8 @@ GridLayout {
                             return;
                         }
 
-                        backend.replaceDesktops(draggedDesktopButton.number, desktopButton.number);
-                        draggedDesktopButton = desktopButton;
+                        // Only the buttons get reordered until the drag is over
+                        backend.previewMoveDesktop(draggedDesktopButton.number, desktopButton.number);
                     }
                 }
             }
@@ -89,6 +112,9 @@ GridLayout {
 
         onReleased: {
             if (isDragging) {
+                backend.moveDesktop(draggedDesktopButtonInitialNumber,
+                                    draggedDesktopButton ? draggedDesktopButton.number :
+                                                           draggedDesktopButtonInitialNumber);
                 draggedDesktopButton = null;
 
                 Qt.callLater(function() {
@@ -97,13 +123,20 @@ GridLayout {
             }
         }
 
+        // The pointer may be taken away in the middle of a drag
+        onCanceled: {
+            if (isDragging) {
+                backend.cancelMoveDesktop();
+                draggedDesktopButton = null;
+                isDragging = false;
+            }
+        }
+
         onWheel: {
             if (!config.MouseWheelSwitchDesktopOnScroll) {
                 return;
             }
 
-            var desktopNumber = 0;
-
             var change = wheel.angleDelta.y || wheel.angleDelta.x;
             if (!config.MouseWheelInvertDesktopSwitchingDirection) {
                 change = -change;
@@ -111,167 +144,40 @@ GridLayout {
 
             currentWheelDelta += change;
 
-            if (currentWheelDelta >= wheelDeltaLimit) {
-                currentWheelDelta = 0;
+            // The backend merges the steps of a burst into a single switch
+            var steps = (currentWheelDelta / wheelDeltaLimit) | 0;
+            if (steps != 0) {
+                currentWheelDelta -= steps * wheelDeltaLimit;
 
-                if (currentDesktopButton && currentDesktopButton.number < desktopButtonList.length) {
-                    desktopNumber = currentDesktopButton.number + 1;
-                } else if (config.MouseWheelWrapDesktopNavigationWhenScrolling) {
-                    desktopNumber = 1;
-                }
-            }
-
-            if (currentWheelDelta <= -wheelDeltaLimit) {
-                currentWheelDelta = 0;
-
-                if (currentDesktopButton && currentDesktopButton.number > 1) {
-                    desktopNumber = currentDesktopButton.number - 1;
-                } else if (config.MouseWheelWrapDesktopNavigationWhenScrolling) {
-                    desktopNumber = desktopButtonList.length;
-                }
-            }
-
-            if (desktopNumber > 0) {
                 if (config.TooltipsEnable) {
                     tooltip.visible = false;
                 }
 
-                backend.showDesktop(desktopNumber);
+                backend.switchDesktopBy(steps, config.MouseWheelWrapDesktopNavigationWhenScrolling);
             }
         }
     }
 
-    function update(desktopInfoList) {
-        var difference = desktopInfoList.length - desktopButtonList.length;
-        var synchronousUpdate = true;
-
-        if (difference > 0) {
-            addDesktopButtons(difference);
-        } else if (difference < 0) {
-            removeDesktopButtons(desktopInfoList);
-            synchronousUpdate = !config.AnimationsEnable;
-        }
-
-        if (synchronousUpdate) {
-            updateDesktopButtons(desktopInfoList);
-        }
-
-        lastDesktopButton = desktopButtonList[desktopButtonList.length - 1];
-    }
-
-    function addDesktopButtons(difference) {
-        var init = desktopButtonList.length == 0;
-        var temp = difference;
-
-        while (temp-- > 0) {
-            var desktopButton = desktopButtonComponent.createObject(desktopButtonContainer);
-            desktopButtonList.push(desktopButton);
-        }
-
-        if (!init && difference != 0 &&
-            !config.DynamicDesktopsEnable) {
-            if (config.AddingDesktopsSwitchTo) {
-                Utils.delay(100, function() {
-                    backend.showDesktop(desktopButtonList.length);
-                });
-            }
-            if (config.AddingDesktopsPromptToRename) {
-                Utils.delay(100, function() {
-                    renamePopup.show(desktopButtonList[desktopButtonList.length - 1]);
-                });
-            }
-        }
-    }
-
-    function removeDesktopButtons(desktopInfoList) {
-        var list = getRemovedDesktopButtonIndexList(desktopInfoList);
-
-        while (list.length > 0) {
-            var index = list.pop();
-            var desktopButton = desktopButtonList[index];
-            desktopButtonList.splice(index, 1);
-
-            if (lastHoveredButton == desktopButton) {
-                lastHoveredButton = null;
-            }
-
-            if (currentDesktopButton == desktopButton) {
-                currentDesktopButton = null;
-            }
-
-            if (largestDesktopButton == desktopButton) {
-                largestDesktopButton = null;
-            }
-
-            if (config.AnimationsEnable) {
-                desktopButton.hide(function() {
-                    desktopButton.destroy();
-
-                    if (list.length == 0) {
-                        updateDesktopButtons(desktopInfoList);
-                    }
-                }, true);
-                continue;
-            }
-
-            desktopButton.destroy();
-        }
-    }
-
-    function getRemovedDesktopButtonIndexList(desktopInfoList) {
-        var removedDesktopButtonIndexList = [];
-
-        for (var i = 0; i < desktopButtonList.length; i++) {
-            var desktopButton = desktopButtonList[i];
-
-            var keepDesktopButton = false;
-            for (var j = 0; j < desktopInfoList.length; j++) {
-                var desktopInfo = desktopInfoList[j];
-                if (desktopButton.id == desktopInfo.id) {
-                    keepDesktopButton = true;
-                    break;
-                }
-            }
-            if (!keepDesktopButton) {
-                removedDesktopButtonIndexList.push(i);
-            }
+    function handleAddedDesktopButton(desktopButton) {
+        if (config.AddingDesktopsSwitchTo) {
+            Utils.delay(100, function() {
+                backend.showDesktop(desktopButton.number);
+            });
         }
-
-        return removedDesktopButtonIndexList;
-    }
-
-    function updateDesktopButtons(desktopInfoList) {
-        for (var i = 0; i < desktopButtonList.length; i++) {
-            var desktopButton = desktopButtonList[i];
-            var desktopInfo = desktopInfoList[i];
-            desktopButton.update(desktopInfo);
-            desktopButton.show();
-
-            if (desktopButton.isCurrent) {
-                currentDesktopButton = desktopButton;
-            }
+        if (config.AddingDesktopsPromptToRename) {
+            Utils.delay(100, function() {
+                renamePopup.show(desktopButton);
+            });
         }
     }
 
-    function updateLargestDesktopButton() {
-        var temp = largestDesktopButton;
-
-        for (var i = 0; i < desktopButtonList.length; i++) {
-            var desktopButton = desktopButtonList[i];
-
-            if (!temp || temp._label.implicitWidth < desktopButton._label.implicitWidth) {
-                temp = desktopButton;
-            }
+    function handleRemovedDesktopButton(desktopButton) {
+        if (lastHoveredButton == desktopButton) {
+            lastHoveredButton = null;
         }
 
-        if (temp != largestDesktopButton) {
-            largestDesktopButton = temp;
+        if (currentDesktopButton == desktopButton) {
+            currentDesktopButton = null;
         }
     }
-
-    function updateNumberOfVisibleDesktopButtons() {
-        numberOfVisibleDesktopButtons = desktopButtonList.filter(function(desktopButton) {
-            return desktopButton.isVisible;
-        }).length;
-    }
 }
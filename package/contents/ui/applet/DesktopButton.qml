@@ -1,6 +1,5 @@
 import QtQuick 2.7
 import QtQuick.Controls 1.4
-import QtQuick.Layouts 1.3
 
 import "../common/Utils.js" as Utils
 
@@ -8,86 +7,53 @@ Component {
     Rectangle {
         readonly property string objectType: "DesktopButton"
 
-        property int number: 0
-        property string id: ""
-        property string name: ""
-        property bool isCurrent: false
-        property bool isEmpty: false
-        property bool isUrgent: false
-        property string activeWindowName: ""
-        property var windowNameList: []
+        property int number: model.number
+        property string id: model.id
+        property string name: model.name
+        property bool isCurrent: model.isCurrent
+        property bool isEmpty: model.isEmpty
+        property bool isUrgent: model.isUrgent
+        property string activeWindowName: model.activeWindowName
+        property string labelText: model.label
 
         property bool isDragged: container.draggedDesktopButton == this
         property bool ignoreMouseArea: container.isDragging
 
-        property bool isVisible: {
-            if (config.DesktopButtonsShowOnlyForCurrentDesktop &&
-                config.DesktopButtonsShowOnlyForOccupiedDesktops) {
-                return isCurrent || !isEmpty;
+        onIsCurrentChanged: {
+            if (isCurrent) {
+                container.currentDesktopButton = this;
             }
-            if (config.DesktopButtonsShowOnlyForCurrentDesktop) {
-                return isCurrent;
-            }
-            if (config.DesktopButtonsShowOnlyForOccupiedDesktops) {
-                return !isEmpty;
-            }
-            return true;
         }
 
-        onIsVisibleChanged: {
-            container.updateNumberOfVisibleDesktopButtons();
-            Qt.callLater(function() {
-                if (isVisible) {
-                    show();
-                } else {
-                    hide();
-                }
-            });
+        Component.onCompleted: {
+            if (isCurrent) {
+                container.currentDesktopButton = this;
+            }
         }
 
-        property alias _label: label
-        property alias _indicator: indicator
+        // Labels are measured by the backend, with the same font, so the
+        // buttons don't wait for their own text to be laid out
+        property real labelWidth: config.DesktopButtonsSetCommonSizeForAll ?
+                                  backend.desktopListModel.maximumLabelWidth :
+                                  model.labelWidth
 
-        Layout.fillWidth: isVerticalOrientation
-        Layout.fillHeight: !isVerticalOrientation
+        // Only the size along the strip is used, the strip sets the other
+        // one, as well as the position, and whether the button is visible
+        implicitWidth: labelWidth +
+                       2 * config.DesktopButtonsHorizontalMargin +
+                       2 * config.DesktopButtonsSpacing
+
+        implicitHeight: label.implicitHeight +
+                        2 * config.DesktopButtonsVerticalMargin +
+                        2 * config.DesktopButtonsSpacing
 
         clip: true
         color: "transparent"
-        opacity: !config.AnimationsEnable ? 1 : 0
 
         readonly property int tooltipWaitDuration: 800
-        readonly property int animationWidthDuration: 100
         readonly property int animationColorDuration: 150
         readonly property int animationOpacityDuration: 150
 
-        Behavior on opacity {
-            enabled: config.AnimationsEnable
-            animation: NumberAnimation {
-                duration: animationOpacityDuration
-            }
-        }
-
-        Behavior on implicitWidth {
-            id: widthBehavior
-            enabled: config.AnimationsEnable
-            animation: NumberAnimation {
-                duration: animationWidthDuration
-                onRunningChanged: {
-                    if (!running) {
-                        Utils.delay(100, container.updateLargestDesktopButton);
-                    }
-                }
-            }
-        }
-
-        Behavior on implicitHeight {
-            id: heightBehavior
-            enabled: config.AnimationsEnable
-            animation: NumberAnimation {
-                duration: animationWidthDuration
-            }
-        }
-
         /* Indicator */
         Rectangle {
             id: indicator
@@ -153,13 +119,7 @@ Component {
                     if (config.DesktopIndicatorsStyle == 4) {
                         return parent.width;
                     }
-                    if (config.DesktopButtonsSetCommonSizeForAll &&
-                        container.largestDesktopButton &&
-                        container.largestDesktopButton != parent &&
-                        container.largestDesktopButton._label.implicitWidth > label.implicitWidth) {
-                        return container.largestDesktopButton._indicator.width;
-                    }
-                    return label.implicitWidth + 2 * config.DesktopButtonsHorizontalMargin;
+                    return labelWidth + 2 * config.DesktopButtonsHorizontalMargin;
                 }
                 if (config.DesktopIndicatorsStyle == 1) {
                     return config.DesktopIndicatorsStyleLineThickness;
@@ -223,7 +183,7 @@ Component {
             anchors.verticalCenter: parent.verticalCenter
             anchors.horizontalCenter: parent.horizontalCenter
 
-            text: name
+            text: labelText
 
             color: config.DesktopIndicatorsStyle == 5 ?
                    indicator.color :
@@ -316,151 +276,5 @@ Component {
                 }
             }
         }
-
-        function updateLabel() {
-            label.text = Qt.binding(function() {
-                var labelText = name;
-
-                if (config.DesktopLabelsStyle == 1) {
-                    labelText = number + "";
-                } else if (config.DesktopLabelsStyle == 2) {
-                    labelText = number + ": " + name;
-                } else if (config.DesktopLabelsStyle == 3) {
-                    labelText = activeWindowName || name;
-                } else if (config.DesktopLabelsStyle == 4) {
-                    if (config.DesktopLabelsStyleCustomFormat) {
-                        var format = config.DesktopLabelsStyleCustomFormat.trim();
-                        if (format.length > 0) {
-                            labelText = format;
-                            labelText = labelText.replace("$WX", !isEmpty ? activeWindowName : number);
-                            labelText = labelText.replace("$WR", !isEmpty ? activeWindowName : Utils.arabicToRoman(number));
-                            labelText = labelText.replace("$WN", !isEmpty ? activeWindowName : name);
-                            labelText = labelText.replace("$X", number);
-                            labelText = labelText.replace("$R", Utils.arabicToRoman(number));
-                            labelText = labelText.replace("$N", name);
-                            labelText = labelText.replace("$W", activeWindowName);
-                        } else {
-                            labelText = number + ": " + name;
-                        }
-                    }
-                }
-
-                if (labelText.length > config.DesktopLabelsMaximumLength) {
-                    labelText = labelText.substr(0, config.DesktopLabelsMaximumLength - 1) + "…";
-                }
-                if (config.DesktopLabelsDisplayAsUppercased) {
-                    labelText = labelText.toUpperCase();
-                }
-
-                return labelText;
-            });
-        }
-
-        function update(desktopInfo) {
-            number = desktopInfo.number;
-            id = desktopInfo.id;
-            name = desktopInfo.name;
-            isCurrent = desktopInfo.isCurrent;
-            isEmpty = desktopInfo.isEmpty;
-            isUrgent = desktopInfo.isUrgent;
-            activeWindowName = desktopInfo.activeWindowName
-            windowNameList = desktopInfo.windowNameList;
-
-            updateLabel();
-        }
-
-        function show() {
-            if (!isVisible) {
-                return;
-            }
-
-            visible = true;
-            var self = this;
-
-            if (container.numberOfVisibleDesktopButtons == 1) {
-                widthBehavior.enabled = heightBehavior.enabled = false;
-            }
-
-            implicitWidth = Qt.binding(function() {
-                if (isVerticalOrientation) {
-                    return parent.width;
-                }
-
-                var newImplicitWidth = label.implicitWidth +
-                                       2 * config.DesktopButtonsHorizontalMargin +
-                                       2 * config.DesktopButtonsSpacing;
-
-                if (config.DesktopButtonsSetCommonSizeForAll &&
-                    container.largestDesktopButton &&
-                    container.largestDesktopButton != self &&
-                    container.largestDesktopButton.implicitWidth > newImplicitWidth) {
-                    return container.largestDesktopButton.implicitWidth;
-                }
-
-                return newImplicitWidth;
-            });
-
-            implicitHeight = Qt.binding(function() {
-                if (!isVerticalOrientation) {
-                    return parent.height;
-                }
-                return label.implicitHeight +
-                       2 * config.DesktopButtonsVerticalMargin +
-                       2 * config.DesktopButtonsSpacing;
-            });
-
-            if (config.AnimationsEnable) {
-                Utils.delay(animationWidthDuration, function() {
-                    opacity = 1;
-                });
-            } else {
-                opacity = 1;
-            }
-
-            widthBehavior.enabled = heightBehavior.enabled = Qt.binding(function() {
-                return config.AnimationsEnable;
-            });
-        }
-
-        function hide(callback, force) {
-            if (!force && isVisible) {
-                return;
-            }
-
-            opacity = 0;
-
-            if (container.numberOfVisibleDesktopButtons == 1) {
-                widthBehavior.enabled = heightBehavior.enabled = false;
-            }
-
-            var resetDimensions = function() {
-                implicitWidth = isVerticalOrientation ? parent.width : 0;
-                implicitHeight = isVerticalOrientation ? 0: parent.height;
-            }
-
-            var self = this;
-            var postHideCallback = callback ? callback : function() {
-                self.visible = false;
-                widthBehavior.enabled = heightBehavior.enabled = Qt.binding(function() {
-                    return config.AnimationsEnable;
-                });
-            };
-
-            if (config.AnimationsEnable && container.numberOfVisibleDesktopButtons > 1) {
-                Utils.delay(animationOpacityDuration, function() {
-                    resetDimensions();
-                    Utils.delay(animationWidthDuration, postHideCallback);
-                });
-            } else {
-                resetDimensions();
-                postHideCallback();
-            }
-        }
-
-        onImplicitWidthChanged: {
-            if (!config.AnimationsEnable) {
-                Utils.delay(100, container.updateLargestDesktopButton);
-            }
-        }
     }
 }
@@ -0,0 +1,36 @@
+import QtQuick 2.7
+
+import org.kde.plasma.core 2.0 as PlasmaCore
+
+PlasmaCore.Dialog {
+    visible: true
+    visualParent: container
+    type: PlasmaCore.Dialog.Tooltip
+    flags: Qt.WindowDoesNotAcceptFocus
+    location: plasmoid.location
+
+    mainItem: Text {
+        id: statisticsText
+
+        width: implicitWidth
+        height: implicitHeight
+
+        font.family: "monospace"
+        color: theme.textColor
+    }
+
+    Timer {
+        interval: 1000
+        repeat: true
+        running: true
+        triggeredOnStart: true
+        onTriggered: {
+            var statistics = backend.getStatistics();
+            var lines = [];
+            for (var key in statistics) {
+                lines.push(key + ": " + statistics[key]);
+            }
+            statisticsText.text = lines.join("\n");
+        }
+    }
+}
@@ -0,0 +1,99 @@
+#include "ChangeScheduler.hpp"
+
+#include <QGuiApplication>
+#include <QScreen>
+
+static const int defaultMaximumLatency = 100;
+
+ChangeScheduler::ChangeScheduler(QObject* parent) : QObject(parent),
+        pendingTasks(NoTask),
+        holdCount(0),
+        minimumInterval(0),
+        maximumLatency(defaultMaximumLatency),
+        coalescedCount(0),
+        executedCount(0) {
+
+    timer.setSingleShot(true);
+    QObject::connect(&timer, &QTimer::timeout, this, [&] {
+        runPass();
+    });
+}
+
+void ChangeScheduler::schedule(Tasks tasks) {
+    if (pendingTasks) {
+        coalescedCount++;
+    } else {
+        firstChangeTimer.start();
+    }
+
+    pendingTasks |= tasks;
+    armTimer();
+}
+
+void ChangeScheduler::hold() {
+    holdCount++;
+    timer.stop();
+}
+
+void ChangeScheduler::release() {
+    if (holdCount > 0 && --holdCount == 0) {
+        armTimer();
+    }
+}
+
+void ChangeScheduler::setMinimumInterval(int milliseconds) {
+    minimumInterval = qMax(0, milliseconds);
+}
+
+void ChangeScheduler::setMaximumLatency(int milliseconds) {
+    maximumLatency = qMax(0, milliseconds);
+}
+
+quint64 ChangeScheduler::getCoalescedCount() const {
+    return coalescedCount;
+}
+
+quint64 ChangeScheduler::getExecutedCount() const {
+    return executedCount;
+}
+
+int ChangeScheduler::getMinimumInterval() const {
+    if (minimumInterval > 0) {
+        return minimumInterval;
+    }
+
+    auto screen = QGuiApplication::primaryScreen();
+    if (screen && screen->refreshRate() > 0) {
+        return qRound(1000 / screen->refreshRate());
+    }
+    return 16;
+}
+
+void ChangeScheduler::armTimer() {
+    // The pending pass is already bound by both limits
+    if (!pendingTasks || holdCount > 0 || timer.isActive()) {
+        return;
+    }
+
+    qint64 delay = 0;
+    if (lastPassTimer.isValid()) {
+        delay = qMax<qint64>(0, getMinimumInterval() - lastPassTimer.elapsed());
+    }
+
+    qint64 latencyLeft = qMax<qint64>(0, maximumLatency - firstChangeTimer.elapsed());
+    timer.start(int(qMin(delay, latencyLeft)));
+}
+
+void ChangeScheduler::runPass() {
+    if (!pendingTasks || holdCount > 0) {
+        return;
+    }
+
+    Tasks tasks = pendingTasks;
+    pendingTasks = NoTask;
+
+    executedCount++;
+    lastPassTimer.start();
+
+    emit passTriggered(tasks);
+}
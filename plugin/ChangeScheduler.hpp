@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+class ChangeScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    enum Task {
+        NoTask = 0x0,
+        AddEmptyDesktop = 0x1,
+        RemoveEmptyDesktops = 0x2,
+        RenameEmptyDesktops = 0x4,
+        SendDesktopInfoList = 0x8,
+        PublishState = 0x10,
+        AllTasks = AddEmptyDesktop | RemoveEmptyDesktops |
+                   RenameEmptyDesktops | SendDesktopInfoList | PublishState
+    };
+    Q_DECLARE_FLAGS(Tasks, Task)
+
+    ChangeScheduler(QObject* parent = nullptr);
+
+    void schedule(Tasks tasks);
+
+    // Changes scheduled while held are kept until the last release
+    void hold();
+    void release();
+
+    // Zero means throttling passes at the display's frame rate
+    void setMinimumInterval(int milliseconds);
+    void setMaximumLatency(int milliseconds);
+
+    quint64 getCoalescedCount() const;
+    quint64 getExecutedCount() const;
+
+signals:
+    void passTriggered(ChangeScheduler::Tasks tasks);
+
+private:
+    QTimer timer;
+    QElapsedTimer lastPassTimer;
+    QElapsedTimer firstChangeTimer;
+
+    Tasks pendingTasks;
+    int holdCount;
+
+    int minimumInterval;
+    int maximumLatency;
+
+    quint64 coalescedCount;
+    quint64 executedCount;
+
+    int getMinimumInterval() const;
+    void armTimer();
+    void runPass();
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(ChangeScheduler::Tasks)
@@ -0,0 +1,295 @@
+#include "DesktopButtonStrip.hpp"
+
+#include <algorithm>
+
+#include <QPair>
+
+DesktopButtonStrip::DesktopButtonStrip(QQuickItem* parent) : QQuickItem(parent),
+        vertical(false),
+        showOnlyCurrent(false),
+        showOnlyOccupied(false),
+        animationDuration(0),
+        visibleCount(0),
+        targetsDirty(true),
+        populated(false) {
+
+    animation.setStartValue(0.0);
+    animation.setEndValue(1.0);
+
+    QObject::connect(&animation, &QVariantAnimation::valueChanged, this, [&] {
+        polish();
+    });
+
+    QObject::connect(&animation, &QVariantAnimation::finished, this, [&] {
+        polish();
+    });
+
+    QObject::connect(this, &DesktopButtonStrip::verticalChanged, this, [&] {
+        invalidate();
+    });
+
+    QObject::connect(this, &DesktopButtonStrip::showOnlyCurrentChanged, this, [&] {
+        invalidate();
+    });
+
+    QObject::connect(this, &DesktopButtonStrip::showOnlyOccupiedChanged, this, [&] {
+        invalidate();
+    });
+}
+
+QQuickItem* DesktopButtonStrip::buttonAt(qreal x, qreal y) const {
+    qreal position = vertical ? y : x;
+    qreal crossPosition = vertical ? x : y;
+    qreal crossSize = vertical ? width() : height();
+    if (crossPosition < 0 || crossPosition >= crossSize) {
+        return nullptr;
+    }
+
+    // Hidden buttons share their offset with the next one,
+    // so the last button starting at or before the point is the one
+    auto it = std::upper_bound(offsetList.constBegin(), offsetList.constEnd(), position);
+    if (it == offsetList.constBegin()) {
+        return nullptr;
+    }
+
+    int i = int(it - offsetList.constBegin()) - 1;
+    if (position >= offsetList[i] + sizeList[i]) {
+        return nullptr;
+    }
+
+    return buttonList[i];
+}
+
+DesktopListModel* DesktopButtonStrip::getModel() const {
+    return model;
+}
+
+void DesktopButtonStrip::setModel(DesktopListModel* newModel) {
+    if (model == newModel) {
+        return;
+    }
+
+    if (model) {
+        QObject::disconnect(model, nullptr, this, nullptr);
+    }
+    model = newModel;
+
+    if (model) {
+        auto invalidateTargets = [&] {
+            invalidate();
+        };
+
+        QObject::connect(model, &QAbstractItemModel::dataChanged, this, invalidateTargets);
+        QObject::connect(model, &QAbstractItemModel::rowsInserted, this, invalidateTargets);
+        QObject::connect(model, &QAbstractItemModel::rowsRemoved, this, invalidateTargets);
+        QObject::connect(model, &QAbstractItemModel::rowsMoved, this, invalidateTargets);
+        QObject::connect(model, &QAbstractItemModel::modelReset, this, invalidateTargets);
+    }
+
+    invalidate();
+    emit modelChanged();
+}
+
+int DesktopButtonStrip::getVisibleCount() const {
+    return visibleCount;
+}
+
+void DesktopButtonStrip::itemChange(ItemChange change, const ItemChangeData& value) {
+    if (change == ItemChildAddedChange) {
+        auto item = value.item;
+        QObject::connect(item, &QQuickItem::implicitWidthChanged, this, [&] {
+            invalidate();
+        });
+        QObject::connect(item, &QQuickItem::implicitHeightChanged, this, [&] {
+            invalidate();
+        });
+        invalidate();
+    } else if (change == ItemChildRemovedChange) {
+        auto item = value.item;
+        QObject::disconnect(item, nullptr, this, nullptr);
+        buttonStateMap.remove(item);
+
+        // The item may be gone before the next layout
+        int i = buttonList.indexOf(item);
+        if (i >= 0) {
+            buttonList.removeAt(i);
+            offsetList.remove(i);
+            sizeList.remove(i);
+        }
+        invalidate();
+    }
+
+    QQuickItem::itemChange(change, value);
+}
+
+void DesktopButtonStrip::geometryChanged(const QRectF& newGeometry, const QRectF& oldGeometry) {
+    QQuickItem::geometryChanged(newGeometry, oldGeometry);
+
+    // Buttons span the whole strip across
+    if (vertical ? newGeometry.width() != oldGeometry.width() :
+                   newGeometry.height() != oldGeometry.height()) {
+        polish();
+    }
+}
+
+void DesktopButtonStrip::updatePolish() {
+    if (targetsDirty) {
+        updateTargets();
+    }
+    applyLayout();
+}
+
+void DesktopButtonStrip::invalidate() {
+    targetsDirty = true;
+    polish();
+}
+
+void DesktopButtonStrip::updateTargets() {
+    targetsDirty = false;
+
+    QList<QPair<int, QQuickItem*>> numberedButtonList;
+    for (auto item : childItems()) {
+        if (isButton(item)) {
+            numberedButtonList << qMakePair(item->property("number").toInt(), item);
+        }
+    }
+    std::stable_sort(numberedButtonList.begin(), numberedButtonList.end(),
+                     [](const QPair<int, QQuickItem*>& a, const QPair<int, QQuickItem*>& b) {
+        return a.first < b.first;
+    });
+
+    buttonList.clear();
+    for (auto& numberedButton : numberedButtonList) {
+        buttonList << numberedButton.second;
+    }
+
+    int newVisibleCount = 0;
+    QHash<QQuickItem*, ButtonState> targetStateMap;
+    for (auto item : buttonList) {
+        bool shown = isShown(item);
+        if (shown) {
+            newVisibleCount++;
+        }
+
+        ButtonState state;
+        state.toSize = shown ? getTargetSize(item) : 0;
+        state.toOpacity = shown ? 1 : 0;
+        targetStateMap.insert(item, state);
+    }
+
+    bool changed = false;
+    for (auto it = targetStateMap.constBegin(); it != targetStateMap.constEnd(); ++it) {
+        auto oldIt = buttonStateMap.constFind(it.key());
+        if (oldIt == buttonStateMap.constEnd() ||
+            oldIt.value().toSize != it.value().toSize ||
+            oldIt.value().toOpacity != it.value().toOpacity) {
+            changed = true;
+            break;
+        }
+    }
+
+    if (changed) {
+        bool animate = animationDuration > 0 && populated;
+        qreal progress = animation.state() == QAbstractAnimation::Running ?
+                         animation.currentValue().toReal() : 1;
+
+        for (auto it = targetStateMap.begin(); it != targetStateMap.end(); ++it) {
+            auto& state = it.value();
+            auto oldIt = buttonStateMap.constFind(it.key());
+
+            // Animations go on from wherever the buttons are now,
+            // and new buttons grow from nothing
+            if (!animate) {
+                state.fromSize = state.toSize;
+                state.fromOpacity = state.toOpacity;
+            } else if (oldIt != buttonStateMap.constEnd()) {
+                auto& oldState = oldIt.value();
+                state.fromSize = oldState.fromSize + (oldState.toSize - oldState.fromSize) * progress;
+                state.fromOpacity = oldState.fromOpacity + (oldState.toOpacity - oldState.fromOpacity) * progress;
+            }
+        }
+
+        buttonStateMap = targetStateMap;
+
+        animation.stop();
+        if (animate) {
+            animation.setDuration(animationDuration);
+            animation.start();
+        }
+    }
+
+    populated = populated || !buttonList.isEmpty();
+
+    if (visibleCount != newVisibleCount) {
+        visibleCount = newVisibleCount;
+        emit visibleCountChanged();
+    }
+}
+
+void DesktopButtonStrip::applyLayout() {
+    qreal progress = animation.state() == QAbstractAnimation::Running ?
+                     animation.currentValue().toReal() : 1;
+
+    offsetList.clear();
+    sizeList.clear();
+
+    qreal offset = 0;
+    qreal crossSize = 0;
+    for (auto item : buttonList) {
+        auto& state = buttonStateMap[item];
+        qreal size = state.fromSize + (state.toSize - state.fromSize) * progress;
+        qreal opacity = state.fromOpacity + (state.toOpacity - state.fromOpacity) * progress;
+
+        if (vertical) {
+            item->setPosition(QPointF(0, offset));
+            item->setSize(QSizeF(width(), size));
+            crossSize = qMax(crossSize, item->implicitWidth());
+        } else {
+            item->setPosition(QPointF(offset, 0));
+            item->setSize(QSizeF(size, height()));
+            crossSize = qMax(crossSize, item->implicitHeight());
+        }
+        item->setOpacity(opacity);
+        item->setVisible(size > 0 || opacity > 0);
+
+        offsetList << offset;
+        sizeList << size;
+        offset += size;
+    }
+
+    if (vertical) {
+        setImplicitSize(crossSize, offset);
+    } else {
+        setImplicitSize(offset, crossSize);
+    }
+}
+
+bool DesktopButtonStrip::isButton(QQuickItem* item) const {
+    return item->property("number").isValid();
+}
+
+bool DesktopButtonStrip::isShown(QQuickItem* item) const {
+    int row = item->property("number").toInt() - 1;
+    if (!model || row < 0 || row >= model->rowCount()) {
+        return true;
+    }
+
+    auto index = model->index(row);
+    bool isCurrent = model->data(index, DesktopListModel::IsCurrentRole).toBool();
+    bool isEmpty = model->data(index, DesktopListModel::IsEmptyRole).toBool();
+
+    if (showOnlyCurrent && showOnlyOccupied) {
+        return isCurrent || !isEmpty;
+    }
+    if (showOnlyCurrent) {
+        return isCurrent;
+    }
+    if (showOnlyOccupied) {
+        return !isEmpty;
+    }
+    return true;
+}
+
+qreal DesktopButtonStrip::getTargetSize(QQuickItem* item) const {
+    return vertical ? item->implicitHeight() : item->implicitWidth();
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QQuickItem>
+#include <QVariantAnimation>
+#include <QVector>
+
+#include "DesktopListModel.hpp"
+
+// Lays out desktop buttons in a row or a column, in the order of their
+// numbers, and hides the ones filtered out by the settings; all the buttons
+// are animated together, by one pass over them per frame
+class DesktopButtonStrip : public QQuickItem {
+    Q_OBJECT
+
+public:
+    DesktopButtonStrip(QQuickItem* parent = nullptr);
+
+    // Finds the shown button at the given point, by a binary search
+    // over the offsets of the last layout
+    Q_INVOKABLE QQuickItem* buttonAt(qreal x, qreal y) const;
+
+    // Whether a desktop is current and empty is read from the model,
+    // and buttons are matched with its rows by their number property
+    Q_PROPERTY(DesktopListModel* model
+               READ getModel
+               WRITE setModel
+               NOTIFY modelChanged);
+
+    Q_PROPERTY(bool vertical
+               MEMBER vertical
+               NOTIFY verticalChanged);
+
+    Q_PROPERTY(bool showOnlyCurrent
+               MEMBER showOnlyCurrent
+               NOTIFY showOnlyCurrentChanged);
+
+    Q_PROPERTY(bool showOnlyOccupied
+               MEMBER showOnlyOccupied
+               NOTIFY showOnlyOccupiedChanged);
+
+    // Buttons jump to their places right away when it's zero
+    Q_PROPERTY(int animationDuration
+               MEMBER animationDuration
+               NOTIFY animationDurationChanged);
+
+    Q_PROPERTY(int visibleCount
+               READ getVisibleCount
+               NOTIFY visibleCountChanged);
+
+    DesktopListModel* getModel() const;
+    void setModel(DesktopListModel* newModel);
+    int getVisibleCount() const;
+
+signals:
+    void modelChanged();
+    void verticalChanged();
+    void showOnlyCurrentChanged();
+    void showOnlyOccupiedChanged();
+    void animationDurationChanged();
+    void visibleCountChanged();
+
+protected:
+    virtual void itemChange(ItemChange change, const ItemChangeData& value) override;
+    virtual void geometryChanged(const QRectF& newGeometry, const QRectF& oldGeometry) override;
+    virtual void updatePolish() override;
+
+private:
+    // Sizes are along the strip, the other dimension is the strip's own
+    class ButtonState {
+    public:
+        qreal fromSize = 0;
+        qreal toSize = 0;
+        qreal fromOpacity = 0;
+        qreal toOpacity = 0;
+    };
+
+    QPointer<DesktopListModel> model;
+    bool vertical;
+    bool showOnlyCurrent;
+    bool showOnlyOccupied;
+    int animationDuration;
+    int visibleCount;
+
+    QHash<QQuickItem*, ButtonState> buttonStateMap;
+    QVariantAnimation animation;
+
+    // Targets are worked out again only after something has changed,
+    // while frames of an animation just move the buttons
+    bool targetsDirty;
+
+    // Buttons showing up after the first layout grow from nothing
+    bool populated;
+
+    QList<QQuickItem*> buttonList;
+    QVector<qreal> offsetList;
+    QVector<qreal> sizeList;
+
+    void invalidate();
+    void updateTargets();
+    void applyLayout();
+
+    bool isButton(QQuickItem* item) const;
+    bool isShown(QQuickItem* item) const;
+    qreal getTargetSize(QQuickItem* item) const;
+};
@@ -0,0 +1,127 @@
+#include "DesktopCache.hpp"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+void DesktopCache::open(const QString& name) {
+    QString dirPath = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) +
+                      "/org.kde.plasma.virtualdesktopbar";
+    filePath = dirPath + "/" + name + ".cache";
+
+    desktopInfoList.clear();
+    if (!load()) {
+        desktopInfoList.clear();
+    }
+    updateIndex();
+}
+
+bool DesktopCache::isEmpty() const {
+    return desktopInfoList.isEmpty();
+}
+
+const QList<DesktopInfo>& DesktopCache::getDesktopInfoList() const {
+    return desktopInfoList;
+}
+
+const DesktopInfo* DesktopCache::getDesktopInfo(int number) const {
+    return number >= 1 && number <= desktopInfoList.length() ? &desktopInfoList[number - 1] : nullptr;
+}
+
+const DesktopInfo* DesktopCache::getDesktopInfo(const QString& id) const {
+    auto it = indexById.constFind(id);
+    return it != indexById.constEnd() ? &desktopInfoList[it.value()] : nullptr;
+}
+
+void DesktopCache::save(const QList<DesktopInfo>& newDesktopInfoList) {
+    if (filePath.isEmpty() || isSame(desktopInfoList, newDesktopInfoList)) {
+        return;
+    }
+
+    desktopInfoList = newDesktopInfoList;
+    updateIndex();
+
+    QDir().mkpath(QFileInfo(filePath).path());
+
+    // Written aside and renamed, so that a crash never leaves half a file
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning("Cannot write the desktop cache to %s: %s", qPrintable(filePath), qPrintable(file.errorString()));
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_9);
+    stream << magic << version << quint32(desktopInfoList.length());
+    for (auto& desktopInfo : desktopInfoList) {
+        stream << desktopInfo.id << desktopInfo.name
+               << desktopInfo.isEmpty << desktopInfo.isUrgent
+               << desktopInfo.label << qint32(desktopInfo.labelWidth);
+    }
+
+    if (!file.commit()) {
+        qWarning("Cannot write the desktop cache to %s: %s", qPrintable(filePath), qPrintable(file.errorString()));
+    }
+}
+
+bool DesktopCache::load() {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_9);
+
+    // Caches of other versions are simply replaced later on
+    quint32 fileMagic;
+    quint16 fileVersion;
+    quint32 count;
+    stream >> fileMagic >> fileVersion >> count;
+    if (stream.status() != QDataStream::Ok || fileMagic != magic || fileVersion != version) {
+        return false;
+    }
+
+    for (quint32 i = 0; i < count; i++) {
+        DesktopInfo desktopInfo;
+        qint32 labelWidth;
+        stream >> desktopInfo.id >> desktopInfo.name
+               >> desktopInfo.isEmpty >> desktopInfo.isUrgent
+               >> desktopInfo.label >> labelWidth;
+        if (stream.status() != QDataStream::Ok) {
+            return false;
+        }
+
+        desktopInfo.number = int(i) + 1;
+        desktopInfo.labelWidth = labelWidth;
+        desktopInfoList << desktopInfo;
+    }
+
+    return true;
+}
+
+void DesktopCache::updateIndex() {
+    indexById.clear();
+    for (int i = 0; i < desktopInfoList.length(); i++) {
+        indexById.insert(desktopInfoList[i].id, i);
+    }
+}
+
+bool DesktopCache::isSame(const QList<DesktopInfo>& a, const QList<DesktopInfo>& b) {
+    if (a.length() != b.length()) {
+        return false;
+    }
+
+    for (int i = 0; i < a.length(); i++) {
+        if (a[i].id != b[i].id || a[i].name != b[i].name ||
+            a[i].isEmpty != b[i].isEmpty || a[i].isUrgent != b[i].isUrgent ||
+            a[i].label != b[i].label || a[i].labelWidth != b[i].labelWidth) {
+            return false;
+        }
+    }
+
+    return true;
+}
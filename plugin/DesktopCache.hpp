@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include "DesktopInfo.hpp"
+
+// Desktops as an applet last showed them, kept on disk so that the next
+// start can show them before the live state is known
+class DesktopCache {
+public:
+    static const quint32 magic = 0x56444243; // "VDBC"
+    static const quint16 version = 1;
+
+    // Every applet has a file of its own, as applets on different screens
+    // may see different occupancy, and their labels differ in size
+    void open(const QString& name);
+
+    bool isEmpty() const;
+    const QList<DesktopInfo>& getDesktopInfoList() const;
+    const DesktopInfo* getDesktopInfo(int number) const;
+    const DesktopInfo* getDesktopInfo(const QString& id) const;
+
+    // Nothing is written when the desktops look as they did last time
+    void save(const QList<DesktopInfo>& newDesktopInfoList);
+
+private:
+    QString filePath;
+    QList<DesktopInfo> desktopInfoList;
+    QHash<QString, int> indexById;
+
+    bool load();
+    void updateIndex();
+
+    static bool isSame(const QList<DesktopInfo>& a, const QList<DesktopInfo>& b);
+};
@@ -3,7 +3,6 @@
 #include <QDBusArgument>
 #include <QList>
 #include <QString>
-#include <QVariantMap>
 
 class DesktopInfo {
 public:
@@ -17,10 +16,10 @@ public:
     bool isEmpty = true;
     bool isUrgent = false;
     QString activeWindowName;
-    QList<QString> windowNameList;
 
-    // "Serializing" method
-    QVariantMap toQVariantMap();
+    // Presentation
+    QString label;
+    int labelWidth = 0;
 };
 
 const QDBusArgument& operator>>(const QDBusArgument& arg, DesktopInfo& desktopInfo);
@@ -0,0 +1,168 @@
+#include "DesktopLabelFormatter.hpp"
+
+#include <QPair>
+
+DesktopLabelFormatter::DesktopLabelFormatter() :
+        style(0),
+        hasCustomFormat(false),
+        maximumLength(25),
+        uppercased(false),
+        fontMetrics(QFont()) {}
+
+void DesktopLabelFormatter::setStyle(int style) {
+    this->style = style;
+}
+
+void DesktopLabelFormatter::setCustomFormat(const QString& format) {
+    // Longer placeholders go first, as they start with the shorter ones
+    static const QVector<QPair<QString, TokenType>> placeholders = {
+        { "$WX", WindowNameOrNumber },
+        { "$WR", WindowNameOrRomanNumber },
+        { "$WN", WindowNameOrName },
+        { "$X", Number },
+        { "$R", RomanNumber },
+        { "$N", Name },
+        { "$W", WindowName }
+    };
+
+    hasCustomFormat = !format.isEmpty();
+    customFormatTokens.clear();
+
+    QString trimmedFormat = format.trimmed();
+    QString text;
+    for (int i = 0; i < trimmedFormat.length();) {
+        bool isPlaceholder = false;
+        if (trimmedFormat[i] == '$') {
+            for (auto& placeholder : placeholders) {
+                if (trimmedFormat.midRef(i, placeholder.first.length()) == placeholder.first) {
+                    if (!text.isEmpty()) {
+                        customFormatTokens << Token { Text, text };
+                        text.clear();
+                    }
+                    customFormatTokens << Token { placeholder.second, QString() };
+                    i += placeholder.first.length();
+                    isPlaceholder = true;
+                    break;
+                }
+            }
+        }
+        if (!isPlaceholder) {
+            text += trimmedFormat[i++];
+        }
+    }
+    if (!text.isEmpty()) {
+        customFormatTokens << Token { Text, text };
+    }
+}
+
+void DesktopLabelFormatter::setMaximumLength(int length) {
+    maximumLength = length;
+}
+
+void DesktopLabelFormatter::setUppercased(bool uppercased) {
+    this->uppercased = uppercased;
+}
+
+void DesktopLabelFormatter::setFont(const QFont& font) {
+    fontMetrics = QFontMetrics(font);
+    widthCache.clear();
+}
+
+bool DesktopLabelFormatter::isActiveWindowNameNeeded() const {
+    if (style == 3) {
+        return true;
+    }
+    if (style == 4) {
+        for (auto& token : customFormatTokens) {
+            if (token.type != Text && token.type != Number &&
+                token.type != RomanNumber && token.type != Name) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+QString DesktopLabelFormatter::format(const DesktopInfo& desktopInfo) const {
+    QString label = desktopInfo.name;
+
+    if (style == 1) {
+        label = QString::number(desktopInfo.number);
+    } else if (style == 2) {
+        label = QString::number(desktopInfo.number) + ": " + desktopInfo.name;
+    } else if (style == 3) {
+        label = !desktopInfo.activeWindowName.isEmpty() ? desktopInfo.activeWindowName : desktopInfo.name;
+    } else if (style == 4 && !hasCustomFormat) {
+        label = desktopInfo.name;
+    } else if (style == 4 && customFormatTokens.isEmpty()) {
+        label = QString::number(desktopInfo.number) + ": " + desktopInfo.name;
+    } else if (style == 4) {
+        bool hasWindow = !desktopInfo.isEmpty;
+        auto& windowName = desktopInfo.activeWindowName;
+
+        label.clear();
+        for (auto& token : customFormatTokens) {
+            switch (token.type) {
+                case Text: label += token.text; break;
+                case WindowNameOrNumber: label += hasWindow ? windowName : QString::number(desktopInfo.number); break;
+                case WindowNameOrRomanNumber: label += hasWindow ? windowName : getRomanNumber(desktopInfo.number); break;
+                case WindowNameOrName: label += hasWindow ? windowName : desktopInfo.name; break;
+                case Number: label += QString::number(desktopInfo.number); break;
+                case RomanNumber: label += getRomanNumber(desktopInfo.number); break;
+                case Name: label += desktopInfo.name; break;
+                case WindowName: label += windowName; break;
+            }
+        }
+    }
+
+    if (maximumLength > 0 && label.length() > maximumLength) {
+        label = label.left(maximumLength - 1) + "…";
+    }
+    if (uppercased) {
+        label = label.toUpper();
+    }
+
+    return label;
+}
+
+int DesktopLabelFormatter::getWidth(const QString& text) const {
+    auto it = widthCache.constFind(text);
+    if (it != widthCache.constEnd()) {
+        return it.value();
+    }
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+    int width = fontMetrics.horizontalAdvance(text);
+#else
+    int width = fontMetrics.width(text);
+#endif
+    widthCache.insert(text, width);
+    return width;
+}
+
+QString DesktopLabelFormatter::getRomanNumber(int number) {
+    static QVector<QString> romanNumbers;
+
+    // KWin allows up to 20 desktops
+    if (romanNumbers.isEmpty()) {
+        static const QVector<QPair<int, QString>> romanDigits = {
+            { 10, "X" }, { 9, "IX" }, { 5, "V" }, { 4, "IV" }, { 1, "I" }
+        };
+
+        romanNumbers << QString();
+        for (int i = 1; i <= 20; i++) {
+            QString romanNumber;
+            for (int n = i, j = 0; n > 0;) {
+                if (n >= romanDigits[j].first) {
+                    romanNumber += romanDigits[j].second;
+                    n -= romanDigits[j].first;
+                } else {
+                    j++;
+                }
+            }
+            romanNumbers << romanNumber;
+        }
+    }
+
+    return romanNumbers.value(number);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QFont>
+#include <QFontMetrics>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include "DesktopInfo.hpp"
+
+// Turns desktops into label texts for the chosen style, with the custom
+// format parsed once instead of being searched for placeholders per label
+class DesktopLabelFormatter {
+public:
+    DesktopLabelFormatter();
+
+    void setStyle(int style);
+    void setCustomFormat(const QString& format);
+    void setMaximumLength(int length);
+    void setUppercased(bool uppercased);
+    void setFont(const QFont& font);
+
+    // The active window's name is looked up only when a label shows it
+    bool isActiveWindowNameNeeded() const;
+
+    QString format(const DesktopInfo& desktopInfo) const;
+
+    // Widths of label texts are remembered until the font changes
+    int getWidth(const QString& text) const;
+
+private:
+    enum TokenType {
+        Text,
+        WindowNameOrNumber,
+        WindowNameOrRomanNumber,
+        WindowNameOrName,
+        Number,
+        RomanNumber,
+        Name,
+        WindowName
+    };
+
+    class Token {
+    public:
+        TokenType type;
+        QString text;
+    };
+
+    int style;
+    bool hasCustomFormat;
+    QVector<Token> customFormatTokens;
+    int maximumLength;
+    bool uppercased;
+
+    QFontMetrics fontMetrics;
+    mutable QHash<QString, int> widthCache;
+
+    static QString getRomanNumber(int number);
+};
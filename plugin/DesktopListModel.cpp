@@ -0,0 +1,237 @@
+#include "DesktopListModel.hpp"
+
+#include <QSet>
+
+DesktopListModel::DesktopListModel(QObject* parent) : QAbstractListModel(parent),
+        maximumLabelWidth(0) {}
+
+int DesktopListModel::getCount() const {
+    return desktopInfoList.size();
+}
+
+int DesktopListModel::getMaximumLabelWidth() const {
+    return maximumLabelWidth;
+}
+
+const QList<DesktopInfo>& DesktopListModel::getDesktopInfoList() const {
+    return desktopInfoList;
+}
+
+int DesktopListModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : desktopInfoList.size();
+}
+
+QVariant DesktopListModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= desktopInfoList.size()) {
+        return QVariant();
+    }
+
+    auto& desktopInfo = desktopInfoList[index.row()];
+
+    switch (role) {
+        case NumberRole: return desktopInfo.number;
+        case IdRole: return desktopInfo.id;
+        case NameRole: return desktopInfo.name;
+        case IsCurrentRole: return desktopInfo.isCurrent;
+        case IsEmptyRole: return desktopInfo.isEmpty;
+        case IsUrgentRole: return desktopInfo.isUrgent;
+        case ActiveWindowNameRole: return desktopInfo.activeWindowName;
+        case LabelRole: return desktopInfo.label;
+        case LabelWidthRole: return desktopInfo.labelWidth;
+    }
+
+    return QVariant();
+}
+
+QHash<int, QByteArray> DesktopListModel::roleNames() const {
+    QHash<int, QByteArray> roles;
+    roles[NumberRole] = "number";
+    roles[IdRole] = "id";
+    roles[NameRole] = "name";
+    roles[IsCurrentRole] = "isCurrent";
+    roles[IsEmptyRole] = "isEmpty";
+    roles[IsUrgentRole] = "isUrgent";
+    roles[ActiveWindowNameRole] = "activeWindowName";
+    roles[LabelRole] = "label";
+    roles[LabelWidthRole] = "labelWidth";
+    return roles;
+}
+
+void DesktopListModel::update(const QList<DesktopInfo>& newDesktopInfoList) {
+    int oldCount = desktopInfoList.size();
+
+    QSet<QString> oldIds;
+    for (auto& desktopInfo : desktopInfoList) {
+        oldIds.insert(desktopInfo.id);
+    }
+
+    QSet<QString> newIds;
+    int unknownCount = 0;
+    for (auto& desktopInfo : newDesktopInfoList) {
+        newIds.insert(desktopInfo.id);
+        if (!oldIds.contains(desktopInfo.id)) {
+            unknownCount++;
+        }
+    }
+
+    int freeCount = 0;
+    for (auto& desktopInfo : desktopInfoList) {
+        if (!newIds.contains(desktopInfo.id)) {
+            freeCount++;
+        }
+    }
+
+    // Rows of gone desktops are reused for new ones (e.g. when KWin hands out
+    // new ids after a restart), so only the surplus is really removed
+    for (int i = desktopInfoList.size() - 1; i >= 0 && freeCount > unknownCount; i--) {
+        if (!newIds.contains(desktopInfoList[i].id)) {
+            beginRemoveRows(QModelIndex(), i, i);
+            removeLabelWidth(desktopInfoList[i].labelWidth);
+            desktopInfoList.removeAt(i);
+            endRemoveRows();
+            freeCount--;
+        }
+    }
+
+    for (int i = 0; i < newDesktopInfoList.size(); i++) {
+        auto& newDesktopInfo = newDesktopInfoList[i];
+        bool isKnown = oldIds.contains(newDesktopInfo.id);
+
+        int j = -1;
+        for (int k = i; k < desktopInfoList.size(); k++) {
+            auto& id = desktopInfoList[k].id;
+            if (isKnown ? id == newDesktopInfo.id : !newIds.contains(id)) {
+                j = k;
+                break;
+            }
+        }
+
+        if (j < 0) {
+            beginInsertRows(QModelIndex(), i, i);
+            addLabelWidth(newDesktopInfo.labelWidth);
+            desktopInfoList.insert(i, newDesktopInfo);
+            endInsertRows();
+            continue;
+        }
+
+        if (j != i) {
+            beginMoveRows(QModelIndex(), j, j, QModelIndex(), i);
+            desktopInfoList.move(j, i);
+            endMoveRows();
+        }
+
+        auto roles = getChangedRoles(desktopInfoList[i], newDesktopInfo);
+        if (!roles.isEmpty()) {
+            if (roles.contains(LabelWidthRole)) {
+                removeLabelWidth(desktopInfoList[i].labelWidth);
+                addLabelWidth(newDesktopInfo.labelWidth);
+            }
+            desktopInfoList[i] = newDesktopInfo;
+            emit dataChanged(index(i), index(i), roles);
+        }
+    }
+
+    if (desktopInfoList.size() > newDesktopInfoList.size()) {
+        beginRemoveRows(QModelIndex(), newDesktopInfoList.size(), desktopInfoList.size() - 1);
+        for (int i = newDesktopInfoList.size(); i < desktopInfoList.size(); i++) {
+            removeLabelWidth(desktopInfoList[i].labelWidth);
+        }
+        desktopInfoList.erase(desktopInfoList.begin() + newDesktopInfoList.size(), desktopInfoList.end());
+        endRemoveRows();
+    }
+
+    if (oldCount != desktopInfoList.size()) {
+        emit countChanged();
+    }
+
+    updateMaximumLabelWidth();
+}
+
+void DesktopListModel::move(int fromIndex, int toIndex) {
+    if (fromIndex == toIndex ||
+        fromIndex < 0 || fromIndex >= desktopInfoList.size() ||
+        toIndex < 0 || toIndex >= desktopInfoList.size()) {
+        return;
+    }
+
+    // The destination is given as a position before the move
+    beginMoveRows(QModelIndex(), fromIndex, fromIndex,
+                  QModelIndex(), toIndex > fromIndex ? toIndex + 1 : toIndex);
+    desktopInfoList.move(fromIndex, toIndex);
+    endMoveRows();
+
+    int firstIndex = qMin(fromIndex, toIndex);
+    int lastIndex = qMax(fromIndex, toIndex);
+    for (int i = firstIndex; i <= lastIndex; i++) {
+        desktopInfoList[i].number = i + 1;
+    }
+    emit dataChanged(index(firstIndex), index(lastIndex), { NumberRole });
+}
+
+void DesktopListModel::setCurrent(int oldNumber, int newNumber) {
+    for (int i : { oldNumber - 1, newNumber - 1 }) {
+        if (i < 0 || i >= desktopInfoList.size()) {
+            continue;
+        }
+
+        bool isCurrent = desktopInfoList[i].number == newNumber;
+        if (desktopInfoList[i].isCurrent != isCurrent) {
+            desktopInfoList[i].isCurrent = isCurrent;
+            emit dataChanged(index(i), index(i), { IsCurrentRole });
+        }
+    }
+}
+
+void DesktopListModel::addLabelWidth(int width) {
+    labelWidthCounts[width]++;
+}
+
+void DesktopListModel::removeLabelWidth(int width) {
+    auto it = labelWidthCounts.find(width);
+    if (it != labelWidthCounts.end() && --it.value() == 0) {
+        labelWidthCounts.erase(it);
+    }
+}
+
+void DesktopListModel::updateMaximumLabelWidth() {
+    int width = labelWidthCounts.isEmpty() ? 0 : labelWidthCounts.lastKey();
+    if (maximumLabelWidth != width) {
+        maximumLabelWidth = width;
+        emit maximumLabelWidthChanged();
+    }
+}
+
+QVector<int> DesktopListModel::getChangedRoles(const DesktopInfo& oldDesktopInfo,
+                                               const DesktopInfo& newDesktopInfo) const {
+    QVector<int> roles;
+
+    if (oldDesktopInfo.number != newDesktopInfo.number) {
+        roles << NumberRole;
+    }
+    if (oldDesktopInfo.id != newDesktopInfo.id) {
+        roles << IdRole;
+    }
+    if (oldDesktopInfo.name != newDesktopInfo.name) {
+        roles << NameRole;
+    }
+    if (oldDesktopInfo.isCurrent != newDesktopInfo.isCurrent) {
+        roles << IsCurrentRole;
+    }
+    if (oldDesktopInfo.isEmpty != newDesktopInfo.isEmpty) {
+        roles << IsEmptyRole;
+    }
+    if (oldDesktopInfo.isUrgent != newDesktopInfo.isUrgent) {
+        roles << IsUrgentRole;
+    }
+    if (oldDesktopInfo.activeWindowName != newDesktopInfo.activeWindowName) {
+        roles << ActiveWindowNameRole;
+    }
+    if (oldDesktopInfo.label != newDesktopInfo.label) {
+        roles << LabelRole;
+    }
+    if (oldDesktopInfo.labelWidth != newDesktopInfo.labelWidth) {
+        roles << LabelWidthRole;
+    }
+
+    return roles;
+}
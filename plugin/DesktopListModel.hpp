@@ -0,0 +1,70 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QVector>
+
+#include "DesktopInfo.hpp"
+
+class DesktopListModel : public QAbstractListModel {
+    Q_OBJECT
+
+    Q_PROPERTY(int count READ getCount NOTIFY countChanged)
+
+    // Width of the widest label, kept up to date as labels change
+    Q_PROPERTY(int maximumLabelWidth READ getMaximumLabelWidth NOTIFY maximumLabelWidthChanged)
+
+public:
+    enum Roles {
+        NumberRole = Qt::UserRole + 1,
+        IdRole,
+        NameRole,
+        IsCurrentRole,
+        IsEmptyRole,
+        IsUrgentRole,
+        ActiveWindowNameRole,
+        LabelRole,
+        LabelWidthRole
+    };
+
+    DesktopListModel(QObject* parent = nullptr);
+
+    int getCount() const;
+    int getMaximumLabelWidth() const;
+    const QList<DesktopInfo>& getDesktopInfoList() const;
+
+    virtual int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    virtual QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    virtual QHash<int, QByteArray> roleNames() const override;
+
+    // Applies the new list as a set of row insertions, removals,
+    // moves and changes of only these roles that really changed
+    void update(const QList<DesktopInfo>& newDesktopInfoList);
+
+    // Moves a single row and renumbers the rows in between, without
+    // touching the real desktops, e.g. to preview dragging a desktop
+    void move(int fromIndex, int toIndex);
+
+    // Moves the current flag between two rows, nothing else is touched
+    void setCurrent(int oldNumber, int newNumber);
+
+signals:
+    void countChanged();
+    void maximumLabelWidthChanged();
+
+private:
+    QList<DesktopInfo> desktopInfoList;
+
+    // Number of labels per width
+    QMap<int, int> labelWidthCounts;
+    int maximumLabelWidth;
+    void addLabelWidth(int width);
+    void removeLabelWidth(int width);
+    void updateMaximumLabelWidth();
+
+    QVector<int> getChangedRoles(const DesktopInfo& oldDesktopInfo,
+                                 const DesktopInfo& newDesktopInfo) const;
+};
@@ -0,0 +1,384 @@
+#include "DesktopManager.hpp"
+
+#include <algorithm>
+
+#include <QDBusArgument>
+#include <QDBusConnection>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDBusVariant>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+#include <QTimer>
+
+#include "Statistics.hpp"
+
+static const QString kwinService = "org.kde.KWin";
+static const QString kwinDesktopManagerPath = "/VirtualDesktopManager";
+
+// How long a request may wait for KWin before it's considered lost
+static const int defaultLatencyBudget = 500;
+
+DesktopManager::DesktopManager(WindowSystemBackend* backend, QObject* parent) : QObject(parent),
+        backend(backend),
+        dbusInterface(kwinService, kwinDesktopManagerPath),
+        dbusInterfaceName("org.kde.KWin.VirtualDesktopManager"),
+        dbusServiceWatcher(kwinService, QDBusConnection::sessionBus(),
+                           QDBusServiceWatcher::WatchForRegistration),
+        usingFallback(true),
+        loadingDesktopInfoList(false),
+        commandPending(false) {
+
+    dbusInterface.setTimeout(defaultLatencyBudget);
+
+    setUpSignals();
+    loadDesktopInfoList();
+}
+
+bool DesktopManager::isUsingFallback() const {
+    return usingFallback;
+}
+
+int DesktopManager::getNumberOfDesktops() const {
+    return desktopIdList.size();
+}
+
+DesktopInfo DesktopManager::getDesktopInfo(int number) const {
+    if (number < 1 || number > desktopIdList.size()) {
+        return DesktopInfo();
+    }
+
+    // Numbers reported by KWin can lag behind during reordering,
+    // so the position in the ordered list is what counts here
+    DesktopInfo desktopInfo = desktopInfoMap.value(desktopIdList[number - 1]);
+    desktopInfo.number = number;
+    return desktopInfo;
+}
+
+DesktopInfo DesktopManager::getDesktopInfo(const QString& id) const {
+    return getDesktopInfo(desktopNumberById.value(id));
+}
+
+QList<DesktopInfo> DesktopManager::getDesktopInfoList() const {
+    QList<DesktopInfo> desktopInfoList;
+    for (int i = 1; i <= desktopIdList.size(); i++) {
+        desktopInfoList << getDesktopInfo(i);
+    }
+    return desktopInfoList;
+}
+
+void DesktopManager::renameDesktop(int number, const QString& name) {
+    Command command;
+    command.method = "setDesktopName";
+    command.id = getDesktopInfo(number).id;
+    command.number = number;
+    command.arguments << command.id << name;
+    command.fallback = [=](int number) {
+        backend->setDesktopName(number, name);
+    };
+    enqueueCommand(command);
+}
+
+void DesktopManager::removeDesktops(const QList<int>& numbers,
+                                    std::function<void(QList<int>)> finished) {
+    QList<int> sortedNumbers;
+    for (int number : numbers) {
+        if (number >= 1 && number <= desktopIdList.size() && !sortedNumbers.contains(number)) {
+            sortedNumbers << number;
+        }
+    }
+    std::sort(sortedNumbers.begin(), sortedNumbers.end());
+
+    if (sortedNumbers.isEmpty()) {
+        if (finished) {
+            finished(QList<int>());
+        }
+        return;
+    }
+
+    auto failedNumbers = QSharedPointer<QList<int>>::create();
+
+    for (int i = 0; i < sortedNumbers.size(); i++) {
+        Command command;
+        command.method = "removeDesktop";
+        command.id = getDesktopInfo(sortedNumbers[i]).id;
+        command.number = sortedNumbers[i];
+        command.arguments << command.id;
+        command.fallback = [=](int number) {
+            *failedNumbers << number;
+        };
+        if (i == sortedNumbers.size() - 1) {
+            command.finished = [=] {
+                if (finished) {
+                    finished(*failedNumbers);
+                }
+            };
+        }
+        enqueueCommand(command);
+    }
+}
+
+void DesktopManager::setLatencyBudget(int milliseconds) {
+    // D-Bus itself would wait for much longer than any budget
+    dbusInterface.setTimeout(milliseconds > 0 ? milliseconds : defaultLatencyBudget);
+}
+
+void DesktopManager::enqueueCommand(const Command& command) {
+    commandQueue.enqueue(command);
+    sendNextCommand();
+}
+
+void DesktopManager::sendNextCommand() {
+    // Commands wait for the initial desktop list to know where to go
+    if (commandPending || loadingDesktopInfoList) {
+        return;
+    }
+
+    while (!commandQueue.isEmpty()) {
+        Command command = commandQueue.dequeue();
+
+        if (usingFallback) {
+            runCommandFallback(command);
+            if (command.finished) {
+                command.finished();
+            }
+            continue;
+        }
+
+        commandPending = true;
+
+        QElapsedTimer callTimer;
+        callTimer.start();
+
+        auto call = dbusInterface.asyncCallWithArgumentList(command.method, command.arguments);
+        auto watcher = new QDBusPendingCallWatcher(call, this);
+        QObject::connect(watcher, &QDBusPendingCallWatcher::finished, this, [=] {
+            watcher->deleteLater();
+            commandPending = false;
+            recordCall(callTimer, *watcher);
+            handleCommandReply(command, *watcher);
+            if (command.finished) {
+                command.finished();
+            }
+            sendNextCommand();
+        });
+        return;
+    }
+}
+
+void DesktopManager::handleCommandReply(const Command& command, const QDBusPendingCall& call) {
+    if (!call.isError()) {
+        emit operationFinished(command.method, command.number);
+        return;
+    }
+
+    // KWin may still carry out a request that ran out of time,
+    // so the fallback is only meant for KWin not supporting it
+    auto errorType = call.error().type();
+    if (errorType == QDBusError::NoReply || errorType == QDBusError::Timeout) {
+        emit operationFailed(command.method, command.number, call.error().message());
+        return;
+    }
+
+    runCommandFallback(command);
+}
+
+void DesktopManager::recordCall(const QElapsedTimer& callTimer, const QDBusPendingCall& call) {
+    auto& statistics = Statistics::get();
+    statistics.increment(Statistics::DBusCalls);
+    statistics.record(Statistics::DBusLatency, callTimer.nsecsElapsed());
+    if (call.isError()) {
+        statistics.increment(Statistics::DBusErrors);
+    }
+}
+
+void DesktopManager::runCommandFallback(const Command& command) {
+    int number = desktopNumberById.value(command.id, command.number);
+
+    if (command.fallback) {
+        command.fallback(number);
+    }
+
+    emit operationFinished(command.method, number);
+}
+
+void DesktopManager::setUpSignals() {
+    if (backend->isLiveSession()) {
+        setUpKWinDBusSignals();
+    }
+
+    QObject::connect(backend, &WindowSystemBackend::numberOfDesktopsChanged, this, [&] {
+        if (usingFallback) {
+            loadFallbackDesktopInfoList();
+            emit desktopsChanged();
+        }
+    });
+
+    QObject::connect(backend, &WindowSystemBackend::desktopNamesChanged, this, [&] {
+        if (usingFallback) {
+            loadFallbackDesktopInfoList();
+            emit desktopsChanged();
+        }
+    });
+
+    // KWin may get restarted, and then the desktop ids are different
+    QObject::connect(&dbusServiceWatcher, &QDBusServiceWatcher::serviceRegistered, this, [&] {
+        if (backend->isLiveSession()) {
+            loadDesktopInfoList();
+            emit desktopsChanged();
+        }
+    });
+}
+
+void DesktopManager::setUpKWinDBusSignals() {
+    auto bus = QDBusConnection::sessionBus();
+
+    bus.connect(kwinService, kwinDesktopManagerPath, dbusInterfaceName, "desktopCreated",
+                this, SLOT(onDesktopCreated(QDBusMessage)));
+    bus.connect(kwinService, kwinDesktopManagerPath, dbusInterfaceName, "desktopRemoved",
+                this, SLOT(onDesktopRemoved(QDBusMessage)));
+    bus.connect(kwinService, kwinDesktopManagerPath, dbusInterfaceName, "desktopDataChanged",
+                this, SLOT(onDesktopDataChanged(QDBusMessage)));
+}
+
+void DesktopManager::onDesktopCreated(const QDBusMessage& message) {
+    if (usingFallback || message.arguments().size() < 2) {
+        return;
+    }
+
+    DesktopInfo desktopInfo;
+    message.arguments().at(1).value<QDBusArgument>() >> desktopInfo;
+
+    desktopInfoMap.insert(desktopInfo.id, desktopInfo);
+    updateDesktopIdList(desktopInfo.id);
+    emit desktopsChanged();
+}
+
+void DesktopManager::onDesktopRemoved(const QDBusMessage& message) {
+    if (usingFallback || message.arguments().isEmpty()) {
+        return;
+    }
+
+    if (desktopInfoMap.remove(message.arguments().at(0).toString()) > 0) {
+        updateDesktopIdList();
+        emit desktopsChanged();
+    }
+}
+
+void DesktopManager::onDesktopDataChanged(const QDBusMessage& message) {
+    if (usingFallback || message.arguments().size() < 2) {
+        return;
+    }
+
+    DesktopInfo desktopInfo;
+    message.arguments().at(1).value<QDBusArgument>() >> desktopInfo;
+
+    auto it = desktopInfoMap.find(desktopInfo.id);
+    if (it == desktopInfoMap.end()) {
+        return;
+    }
+
+    bool numberChanged = it.value().number != desktopInfo.number;
+    it.value().number = desktopInfo.number;
+    it.value().name = desktopInfo.name;
+
+    if (numberChanged) {
+        updateDesktopIdList();
+    }
+    emit desktopsChanged();
+}
+
+void DesktopManager::loadDesktopInfoList() {
+    // The window system's data is available right away, so it's used
+    // until KWin replies with the desktop list through D-Bus
+    usingFallback = true;
+    loadFallbackDesktopInfoList();
+
+    // A simulated session has nothing to do with the running KWin
+    if (!backend->isLiveSession()) {
+        return;
+    }
+
+    loadingDesktopInfoList = true;
+
+    QElapsedTimer callTimer;
+    callTimer.start();
+
+    auto call = dbusInterface.asyncCall("Get", dbusInterfaceName, "desktops");
+    auto watcher = new QDBusPendingCallWatcher(call, this);
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, this, [=] {
+        watcher->deleteLater();
+        loadingDesktopInfoList = false;
+        recordCall(callTimer, *watcher);
+
+        QDBusPendingReply<QDBusVariant> reply = *watcher;
+        if (!reply.isError()) {
+            // Extracting data from the D-Bus reply message here
+            // More details at https://stackoverflow.com/a/20206377
+            QList<DesktopInfo> desktopInfoList;
+            auto somethingSomething = reply.value().variant().value<QDBusArgument>();
+            somethingSomething >> desktopInfoList;
+
+            usingFallback = false;
+
+            desktopInfoMap.clear();
+            for (auto& desktopInfo : desktopInfoList) {
+                desktopInfoMap.insert(desktopInfo.id, desktopInfo);
+            }
+            updateDesktopIdList();
+            emit desktopsChanged();
+        } else {
+            auto errorType = reply.error().type();
+            if (errorType == QDBusError::NoReply || errorType == QDBusError::Timeout) {
+                // KWin is busy rather than missing the interface
+                QTimer::singleShot(dbusInterface.timeout(), this, [&] {
+                    loadDesktopInfoList();
+                });
+            }
+        }
+
+        sendNextCommand();
+    });
+}
+
+void DesktopManager::loadFallbackDesktopInfoList() {
+    desktopInfoMap.clear();
+
+    for (int i = 1; i <= backend->numberOfDesktops(); i++) {
+        DesktopInfo desktopInfo;
+        desktopInfo.id = QString::number(i);
+        desktopInfo.number = i;
+        desktopInfo.name = backend->desktopName(i);
+
+        desktopInfoMap.insert(desktopInfo.id, desktopInfo);
+    }
+
+    updateDesktopIdList();
+}
+
+void DesktopManager::updateDesktopIdList(const QString& preferredId) {
+    desktopIdList.clear();
+    desktopIdList.reserve(desktopInfoMap.size());
+    for (auto it = desktopInfoMap.constBegin(); it != desktopInfoMap.constEnd(); it++) {
+        desktopIdList << it.key();
+    }
+
+    // KWin sends shifted numbers of other desktops as separate signals,
+    // so a freshly created desktop goes first when two numbers collide
+    std::sort(desktopIdList.begin(), desktopIdList.end(), [&](const QString& id1, const QString& id2) {
+        int number1 = desktopInfoMap[id1].number;
+        int number2 = desktopInfoMap[id2].number;
+        if (number1 != number2) {
+            return number1 < number2;
+        }
+        if ((id1 == preferredId) != (id2 == preferredId)) {
+            return id1 == preferredId;
+        }
+        return id1 < id2;
+    });
+
+    desktopNumberById.clear();
+    for (int i = 0; i < desktopIdList.size(); i++) {
+        desktopNumberById.insert(desktopIdList[i], i + 1);
+    }
+}
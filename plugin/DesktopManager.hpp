@@ -0,0 +1,96 @@
+#pragma once
+
+#include <functional>
+
+#include <QDBusInterface>
+#include <QDBusMessage>
+#include <QDBusPendingCall>
+#include <QDBusServiceWatcher>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QQueue>
+#include <QString>
+#include <QVariantList>
+#include <QVector>
+
+#include "DesktopInfo.hpp"
+#include "WindowSystemBackend.hpp"
+
+class DesktopManager : public QObject {
+    Q_OBJECT
+
+public:
+    DesktopManager(WindowSystemBackend* backend, QObject* parent = nullptr);
+
+    bool isUsingFallback() const;
+
+    int getNumberOfDesktops() const;
+    DesktopInfo getDesktopInfo(int number) const;
+    DesktopInfo getDesktopInfo(const QString& id) const;
+    QList<DesktopInfo> getDesktopInfoList() const;
+
+    // Requests are sent to KWin asynchronously, one at a time,
+    // and the fallback gets the desktop's number at the time of failure
+    void renameDesktop(int number, const QString& name);
+
+    // All the numbers are resolved against the same table, so they don't
+    // get stale as desktops go away, and the callback runs once at the end
+    // with numbers of desktops which KWin couldn't remove by itself
+    void removeDesktops(const QList<int>& numbers,
+                        std::function<void(QList<int>)> finished);
+
+    // How long a request may wait for KWin, zero means the default
+    void setLatencyBudget(int milliseconds);
+
+signals:
+    void desktopsChanged();
+    void operationFinished(QString operation, int number);
+    void operationFailed(QString operation, int number, QString errorMessage);
+
+private slots:
+    void onDesktopCreated(const QDBusMessage& message);
+    void onDesktopRemoved(const QDBusMessage& message);
+    void onDesktopDataChanged(const QDBusMessage& message);
+
+private:
+    WindowSystemBackend* backend;
+
+    QDBusInterface dbusInterface;
+    QString dbusInterfaceName;
+    QDBusServiceWatcher dbusServiceWatcher;
+    bool usingFallback;
+    bool loadingDesktopInfoList;
+
+    class Command {
+    public:
+        QString method;
+        QString id;
+        int number;
+        QVariantList arguments;
+        std::function<void(int)> fallback;
+        std::function<void()> finished;
+    };
+
+    QQueue<Command> commandQueue;
+    bool commandPending;
+
+    void enqueueCommand(const Command& command);
+    void sendNextCommand();
+    void handleCommandReply(const Command& command, const QDBusPendingCall& call);
+    void runCommandFallback(const Command& command);
+
+    void recordCall(const QElapsedTimer& callTimer, const QDBusPendingCall& call);
+
+    QHash<QString, DesktopInfo> desktopInfoMap;
+    QVector<QString> desktopIdList;
+    QHash<QString, int> desktopNumberById;
+
+    void setUpSignals();
+    void setUpKWinDBusSignals();
+
+    void loadDesktopInfoList();
+    void loadFallbackDesktopInfoList();
+    void updateDesktopIdList(const QString& preferredId = QString());
+};
@@ -0,0 +1,59 @@
+#include "HookRunner.hpp"
+
+#include "HookWorker.hpp"
+
+HookRunner::HookRunner(QObject* parent) : QObject(parent),
+        worker(new HookWorker()) {
+
+    worker->moveToThread(&workerThread);
+    QObject::connect(&workerThread, &QThread::finished, worker, &QObject::deleteLater);
+    QObject::connect(this, &HookRunner::jobRequested, worker, &HookWorker::run);
+
+    workerThread.setObjectName("VirtualDesktopBarHooks");
+    workerThread.start();
+}
+
+HookRunner::~HookRunner() {
+    workerThread.quit();
+    workerThread.wait();
+}
+
+void HookRunner::setCommand(Hook hook, const QString& command) {
+    commandList[hook] = command;
+}
+
+bool HookRunner::hasCommand(Hook hook) const {
+    return !commandList[hook].isEmpty();
+}
+
+void HookRunner::run(Hook hook, const DesktopInfo& desktopInfo, int previousNumber) {
+    if (hasCommand(hook)) {
+        runCommand(commandList[hook], hook, desktopInfo, previousNumber);
+    }
+}
+
+void HookRunner::runCommand(const QString& command, Hook hook,
+                            const DesktopInfo& desktopInfo, int previousNumber) {
+    QStringList environment;
+    environment << "VDB_HOOK=" + getHookName(hook);
+    environment << "VDB_DESKTOP_ID=" + desktopInfo.id;
+    environment << "VDB_DESKTOP_NUMBER=" + QString::number(desktopInfo.number);
+    environment << "VDB_DESKTOP_NAME=" + desktopInfo.name;
+    if (previousNumber > 0) {
+        environment << "VDB_PREVIOUS_DESKTOP_NUMBER=" + QString::number(previousNumber);
+    }
+
+    emit jobRequested(command, environment);
+}
+
+QString HookRunner::getHookName(Hook hook) {
+    switch (hook) {
+        case DesktopAdded: return "desktopAdded";
+        case DesktopRemoved: return "desktopRemoved";
+        case DesktopSwitched: return "desktopSwitched";
+        case DesktopBecameEmpty: return "desktopBecameEmpty";
+        case DesktopBecameOccupied: return "desktopBecameOccupied";
+        case HookCount: break;
+    }
+    return QString();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+
+#include "DesktopInfo.hpp"
+
+class HookWorker;
+
+// Runs commands configured for desktop events, with details passed
+// in VDB_* environment variables, e.g. VDB_DESKTOP_NUMBER
+class HookRunner : public QObject {
+    Q_OBJECT
+
+public:
+    enum Hook {
+        DesktopAdded,
+        DesktopRemoved,
+        DesktopSwitched,
+        DesktopBecameEmpty,
+        DesktopBecameOccupied,
+        HookCount
+    };
+
+    HookRunner(QObject* parent = nullptr);
+    ~HookRunner();
+
+    void setCommand(Hook hook, const QString& command);
+    bool hasCommand(Hook hook) const;
+
+    // The previous number is only passed on for switches
+    void run(Hook hook, const DesktopInfo& desktopInfo, int previousNumber = 0);
+    void runCommand(const QString& command, Hook hook,
+                    const DesktopInfo& desktopInfo, int previousNumber = 0);
+
+signals:
+    void jobRequested(QString command, QStringList environment);
+
+private:
+    QThread workerThread;
+    HookWorker* worker;
+
+    QString commandList[HookCount];
+
+    static QString getHookName(Hook hook);
+};
@@ -0,0 +1,73 @@
+#include "HookWorker.hpp"
+
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QTimer>
+
+// Bursts, e.g. of dynamic desktops being added, run only a few at a time
+static const int maximumRunningJobCount = 2;
+
+// Long running programs are expected to put themselves in the background
+static const int jobTimeout = 10000;
+
+HookWorker::HookWorker(QObject* parent) : QObject(parent),
+        runningJobCount(0) {}
+
+void HookWorker::run(const QString& command, const QStringList& environment) {
+    Job job;
+    job.command = command;
+    job.environment = environment;
+
+    // The same hook for the same desktop waiting twice would do the same thing
+    if (jobQueue.contains(job)) {
+        return;
+    }
+
+    jobQueue.enqueue(job);
+    startNextJobs();
+}
+
+void HookWorker::startNextJobs() {
+    while (runningJobCount < maximumRunningJobCount && !jobQueue.isEmpty()) {
+        auto job = jobQueue.dequeue();
+
+        auto processEnvironment = QProcessEnvironment::systemEnvironment();
+        for (auto& entry : job.environment) {
+            int i = entry.indexOf('=');
+            processEnvironment.insert(entry.left(i), entry.mid(i + 1));
+        }
+
+        auto process = new QProcess(this);
+        process->setProcessEnvironment(processEnvironment);
+        process->setStandardInputFile(QProcess::nullDevice());
+        process->setStandardOutputFile(QProcess::nullDevice());
+        process->setStandardErrorFile(QProcess::nullDevice());
+
+        auto timeoutTimer = new QTimer(process);
+        timeoutTimer->setSingleShot(true);
+        QObject::connect(timeoutTimer, &QTimer::timeout, process, [=] {
+            qWarning("Hook command timed out: %s", qPrintable(job.command));
+            process->kill();
+        });
+
+        // A process that fails to start never reports being finished
+        auto finish = [=] {
+            process->deleteLater();
+            runningJobCount--;
+            startNextJobs();
+        };
+
+        QObject::connect(process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>
+                                  (&QProcess::finished), this, finish);
+        QObject::connect(process, &QProcess::errorOccurred, this, [=](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) {
+                qWarning("Hook command failed to start: %s", qPrintable(job.command));
+                finish();
+            }
+        });
+
+        runningJobCount++;
+        timeoutTimer->start(jobTimeout);
+        process->start("/bin/sh", { "-c", job.command });
+    }
+}
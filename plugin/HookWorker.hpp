@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QObject>
+#include <QQueue>
+#include <QString>
+#include <QStringList>
+
+// Runs hook commands on its own thread, so that forking never
+// happens on the thread that paints the panel
+class HookWorker : public QObject {
+    Q_OBJECT
+
+public:
+    HookWorker(QObject* parent = nullptr);
+
+public slots:
+    // The environment is given as a list of KEY=VALUE entries
+    void run(const QString& command, const QStringList& environment);
+
+private:
+    struct Job {
+        QString command;
+        QStringList environment;
+
+        bool operator==(const Job& other) const {
+            return command == other.command && environment == other.environment;
+        }
+    };
+
+    QQueue<Job> jobQueue;
+    int runningJobCount;
+
+    void startNextJobs();
+};
@@ -0,0 +1,289 @@
+#include "SimulatedBackend.hpp"
+
+#include <QTimer>
+
+SimulatedBackend::SimulatedBackend(QObject* parent) : WindowSystemBackend(parent),
+        desktopCount(0),
+        currentDesktopNumber(1),
+        nextWindowId(1) {
+
+    int numberOfDesktops = qEnvironmentVariableIntValue("VIRTUALDESKTOPBAR_SIMULATED_DESKTOPS");
+    int numberOfWindows = qEnvironmentVariableIntValue("VIRTUALDESKTOPBAR_SIMULATED_WINDOWS");
+    populate(qMax(1, numberOfDesktops), qMax(0, numberOfWindows));
+}
+
+bool SimulatedBackend::isLiveSession() const {
+    return false;
+}
+
+int SimulatedBackend::numberOfDesktops() const {
+    return desktopCount;
+}
+
+int SimulatedBackend::currentDesktop() const {
+    return currentDesktopNumber;
+}
+
+QString SimulatedBackend::desktopName(int number) const {
+    return desktopNameList.value(number - 1);
+}
+
+QList<WId> SimulatedBackend::windows() const {
+    return windowIdStack;
+}
+
+QList<WId> SimulatedBackend::stackingOrder() const {
+    return windowIdStack;
+}
+
+// The window on top is the active one
+WId SimulatedBackend::activeWindow() const {
+    return windowIdStack.isEmpty() ? 0 : windowIdStack.last();
+}
+
+bool SimulatedBackend::fetchWindowInfo(WId id, NET::Properties properties, WindowInfo& windowInfo) {
+    auto it = windowInfoMap.constFind(id);
+    if (it == windowInfoMap.constEnd()) {
+        return false;
+    }
+
+    windowInfo.id = id;
+    if (properties & NET::WMDesktop) {
+        windowInfo.desktop = it.value().desktop;
+    }
+    if (properties & NET::WMState) {
+        windowInfo.state = it.value().state;
+    }
+    if (properties & NET::WMWindowType) {
+        windowInfo.type = it.value().type;
+        windowInfo.windowClass = it.value().windowClass;
+    }
+    if (properties & NET::WMGeometry) {
+        windowInfo.geometry = it.value().geometry;
+    }
+    if (properties & NET::WMName) {
+        windowInfo.name = it.value().name;
+    }
+
+    return true;
+}
+
+QList<WindowInfo> SimulatedBackend::fetchWindowInfoList(const QList<WId>& ids) {
+    QList<WindowInfo> windowInfoList;
+    for (WId id : ids) {
+        auto it = windowInfoMap.constFind(id);
+        if (it != windowInfoMap.constEnd()) {
+            windowInfoList << it.value();
+        }
+    }
+    return windowInfoList;
+}
+
+void SimulatedBackend::setNumberOfDesktops(int number) {
+    post([=] {
+        if (number < 1 || number == desktopCount) {
+            return;
+        }
+
+        while (desktopNameList.length() < number) {
+            desktopNameList << QString("Desktop %1").arg(desktopNameList.length() + 1);
+        }
+        while (desktopNameList.length() > number) {
+            desktopNameList.removeLast();
+        }
+        desktopCount = number;
+        emit numberOfDesktopsChanged(desktopCount);
+
+        for (auto& windowInfo : windowInfoMap) {
+            if (windowInfo.desktop > desktopCount) {
+                windowInfo.desktop = desktopCount;
+                emit windowChanged(windowInfo.id, NET::WMDesktop);
+            }
+        }
+
+        if (currentDesktopNumber > desktopCount) {
+            currentDesktopNumber = desktopCount;
+            emit currentDesktopChanged(currentDesktopNumber);
+        }
+    });
+}
+
+void SimulatedBackend::setCurrentDesktop(int number) {
+    post([=] {
+        if (number >= 1 && number <= desktopCount && number != currentDesktopNumber) {
+            currentDesktopNumber = number;
+            emit currentDesktopChanged(currentDesktopNumber);
+        }
+    });
+}
+
+void SimulatedBackend::setDesktopName(int number, const QString& name) {
+    post([=] {
+        if (number >= 1 && number <= desktopCount && desktopNameList[number - 1] != name) {
+            desktopNameList[number - 1] = name;
+            emit desktopNamesChanged();
+        }
+    });
+}
+
+void SimulatedBackend::setOnDesktop(WId id, int number) {
+    post([=] {
+        auto it = windowInfoMap.find(id);
+        if (it == windowInfoMap.end() || it.value().desktop == number) {
+            return;
+        }
+        if (number != NET::OnAllDesktops && (number < 1 || number > desktopCount)) {
+            return;
+        }
+
+        it.value().desktop = number;
+        emit windowChanged(id, NET::WMDesktop);
+    });
+}
+
+WId SimulatedBackend::createWindow(int desktop, const QRect& geometry, const QString& name,
+                                   NET::WindowType type, NET::States state) {
+    WId id = nextWindowId++;
+
+    post([=] {
+        WindowInfo windowInfo;
+        windowInfo.id = id;
+        windowInfo.desktop = desktop;
+        windowInfo.geometry = geometry;
+        windowInfo.name = name;
+        windowInfo.type = type;
+        windowInfo.state = state;
+
+        windowInfoMap.insert(id, windowInfo);
+        windowIdStack << id;
+        emit windowAdded(id);
+        emit stackingOrderChanged();
+    });
+
+    return id;
+}
+
+void SimulatedBackend::destroyWindow(WId id) {
+    post([=] {
+        if (windowInfoMap.remove(id) > 0) {
+            windowIdStack.removeOne(id);
+            emit windowRemoved(id);
+            emit stackingOrderChanged();
+        }
+    });
+}
+
+void SimulatedBackend::activateWindow(WId id) {
+    post([=] {
+        if (windowInfoMap.contains(id) && windowIdStack.last() != id) {
+            windowIdStack.removeOne(id);
+            windowIdStack << id;
+            emit stackingOrderChanged();
+        }
+    });
+}
+
+void SimulatedBackend::setWindowState(WId id, NET::States state) {
+    post([=] {
+        auto it = windowInfoMap.find(id);
+        if (it != windowInfoMap.end() && it.value().state != state) {
+            it.value().state = state;
+            emit windowChanged(id, NET::WMState);
+        }
+    });
+}
+
+void SimulatedBackend::setWindowGeometry(WId id, const QRect& geometry) {
+    post([=] {
+        auto it = windowInfoMap.find(id);
+        if (it != windowInfoMap.end() && it.value().geometry != geometry) {
+            it.value().geometry = geometry;
+            emit windowChanged(id, NET::WMGeometry);
+        }
+    });
+}
+
+void SimulatedBackend::setWindowName(WId id, const QString& name) {
+    post([=] {
+        auto it = windowInfoMap.find(id);
+        if (it != windowInfoMap.end() && it.value().name != name) {
+            it.value().name = name;
+            emit windowChanged(id, NET::WMName);
+        }
+    });
+}
+
+void SimulatedBackend::insertWindow(const WindowInfo& windowInfo) {
+    nextWindowId = qMax(nextWindowId, windowInfo.id + 1);
+
+    post([=] {
+        if (windowInfoMap.contains(windowInfo.id)) {
+            return;
+        }
+
+        windowInfoMap.insert(windowInfo.id, windowInfo);
+        windowIdStack << windowInfo.id;
+        emit windowAdded(windowInfo.id);
+        emit stackingOrderChanged();
+    });
+}
+
+void SimulatedBackend::updateWindow(const WindowInfo& windowInfo, NET::Properties properties) {
+    post([=] {
+        auto it = windowInfoMap.find(windowInfo.id);
+        if (it == windowInfoMap.end()) {
+            return;
+        }
+
+        NET::Properties changedProperties;
+        if ((properties & NET::WMDesktop) && it.value().desktop != windowInfo.desktop) {
+            it.value().desktop = windowInfo.desktop;
+            changedProperties |= NET::WMDesktop;
+        }
+        if ((properties & NET::WMState) && it.value().state != windowInfo.state) {
+            it.value().state = windowInfo.state;
+            changedProperties |= NET::WMState;
+        }
+        if ((properties & NET::WMWindowType) && it.value().type != windowInfo.type) {
+            it.value().type = windowInfo.type;
+            changedProperties |= NET::WMWindowType;
+        }
+        if ((properties & NET::WMGeometry) && it.value().geometry != windowInfo.geometry) {
+            it.value().geometry = windowInfo.geometry;
+            changedProperties |= NET::WMGeometry;
+        }
+        if ((properties & NET::WMName) && it.value().name != windowInfo.name) {
+            it.value().name = windowInfo.name;
+            changedProperties |= NET::WMName;
+        }
+
+        if (changedProperties) {
+            emit windowChanged(windowInfo.id, changedProperties);
+        }
+    });
+}
+
+void SimulatedBackend::post(std::function<void()> request) {
+    // Zero timers fire in the order they were started
+    QTimer::singleShot(0, this, request);
+}
+
+void SimulatedBackend::populate(int numberOfDesktops, int numberOfWindows) {
+    desktopCount = numberOfDesktops;
+    for (int i = 1; i <= desktopCount; i++) {
+        desktopNameList << QString("Desktop %1").arg(i);
+    }
+
+    // Windows are spread over desktops and over a grid of 1920x1080 screens
+    for (int i = 0; i < numberOfWindows; i++) {
+        WindowInfo windowInfo;
+        windowInfo.id = nextWindowId++;
+        windowInfo.desktop = i % desktopCount + 1;
+        windowInfo.type = NET::Normal;
+        windowInfo.geometry = QRect((i % 3) * 1920 + (i % 7) * 40, (i % 11) * 30, 800, 600);
+        windowInfo.name = QString("Document %1 - Application %2").arg(i).arg(i % 13);
+
+        windowInfoMap.insert(windowInfo.id, windowInfo);
+        windowIdStack << windowInfo.id;
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <functional>
+
+#include <QHash>
+#include <QList>
+#include <QRect>
+#include <QString>
+
+#include "WindowSystemBackend.hpp"
+
+// Keeps desktops and windows in memory and behaves like a window manager
+// would, e.g. windows of removed desktops go to the last one. Requests
+// are applied in order, each one in its own event loop iteration, and
+// the signals follow, so the timing resembles a real X server
+class SimulatedBackend : public WindowSystemBackend {
+    Q_OBJECT
+
+public:
+    // The initial layout is taken from VIRTUALDESKTOPBAR_SIMULATED_DESKTOPS
+    // and VIRTUALDESKTOPBAR_SIMULATED_WINDOWS, and is the same on every run
+    SimulatedBackend(QObject* parent = nullptr);
+
+    virtual bool isLiveSession() const override;
+
+    virtual int numberOfDesktops() const override;
+    virtual int currentDesktop() const override;
+    virtual QString desktopName(int number) const override;
+
+    virtual QList<WId> windows() const override;
+    virtual QList<WId> stackingOrder() const override;
+    virtual WId activeWindow() const override;
+
+    virtual bool fetchWindowInfo(WId id, NET::Properties properties, WindowInfo& windowInfo) override;
+    virtual QList<WindowInfo> fetchWindowInfoList(const QList<WId>& ids) override;
+
+    virtual void setNumberOfDesktops(int number) override;
+    virtual void setCurrentDesktop(int number) override;
+    virtual void setDesktopName(int number, const QString& name) override;
+    virtual void setOnDesktop(WId id, int number) override;
+
+    // These stand for what applications and the user do
+    WId createWindow(int desktop, const QRect& geometry, const QString& name,
+                     NET::WindowType type = NET::Normal, NET::States state = NET::States());
+    void destroyWindow(WId id);
+    void activateWindow(WId id);
+    void setWindowState(WId id, NET::States state);
+    void setWindowGeometry(WId id, const QRect& geometry);
+    void setWindowName(WId id, const QString& name);
+
+    // These take windows as they were recorded, keeping their ids
+    void insertWindow(const WindowInfo& windowInfo);
+    void updateWindow(const WindowInfo& windowInfo, NET::Properties properties);
+
+private:
+    int desktopCount;
+    int currentDesktopNumber;
+    QList<QString> desktopNameList;
+
+    QHash<WId, WindowInfo> windowInfoMap;
+    QList<WId> windowIdStack;
+    WId nextWindowId;
+
+    void post(std::function<void()> request);
+    void populate(int numberOfDesktops, int numberOfWindows);
+};
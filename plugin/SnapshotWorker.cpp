@@ -0,0 +1,111 @@
+#include "SnapshotWorker.hpp"
+
+#include <cstdlib>
+
+#include <QByteArray>
+
+#include "Statistics.hpp"
+
+SnapshotWorker::SnapshotWorker(QObject* parent) : QObject(parent),
+        latestSerial(0),
+        connection(nullptr),
+        rootWindow(XCB_WINDOW_NONE),
+        clientListAtom(XCB_ATOM_NONE) {}
+
+SnapshotWorker::~SnapshotWorker() {
+    // The fetcher uses the connection, so it has to go first
+    windowFetcher.reset();
+    if (connection) {
+        xcb_disconnect(connection);
+    }
+}
+
+void SnapshotWorker::supersede(quint64 serial) {
+    latestSerial.storeRelease(serial);
+}
+
+void SnapshotWorker::build(quint64 serial) {
+    if (isSuperseded(serial)) {
+        return;
+    }
+
+    if (!openConnection()) {
+        emit snapshotFailed(serial);
+        return;
+    }
+
+    auto windowIds = fetchClientList();
+
+    // The list alone is cheap, details of all windows are not
+    if (isSuperseded(serial)) {
+        return;
+    }
+
+    Statistics::get().increment(Statistics::WindowListFetches);
+    emit snapshotBuilt(WindowSnapshot(serial, windowFetcher->fetch(windowIds)));
+}
+
+bool SnapshotWorker::openConnection() {
+    if (connection) {
+        return true;
+    }
+
+    int screenNumber = 0;
+    auto newConnection = xcb_connect(nullptr, &screenNumber);
+    if (xcb_connection_has_error(newConnection)) {
+        qWarning("Cannot connect to the X server to build window snapshots, falling back to the GUI thread");
+        xcb_disconnect(newConnection);
+        return false;
+    }
+
+    auto it = xcb_setup_roots_iterator(xcb_get_setup(newConnection));
+    for (int i = 0; i < screenNumber && it.rem > 0; i++) {
+        xcb_screen_next(&it);
+    }
+
+    connection = newConnection;
+    rootWindow = it.data->root;
+    windowFetcher.reset(new XcbWindowFetcher(connection, rootWindow));
+
+    QByteArray name = "_NET_CLIENT_LIST";
+    auto cookie = xcb_intern_atom(connection, 0, name.length(), name.constData());
+    auto reply = xcb_intern_atom_reply(connection, cookie, nullptr);
+    if (reply) {
+        clientListAtom = reply->atom;
+        free(reply);
+    }
+
+    return true;
+}
+
+bool SnapshotWorker::isSuperseded(quint64 serial) const {
+    if (serial < latestSerial.loadAcquire()) {
+        Statistics::get().increment(Statistics::SnapshotsSuperseded);
+        return true;
+    }
+    return false;
+}
+
+QList<WId> SnapshotWorker::fetchClientList() {
+    QList<WId> windowIds;
+    if (clientListAtom == XCB_ATOM_NONE) {
+        return windowIds;
+    }
+
+    auto cookie = xcb_get_property(connection, 0, rootWindow, clientListAtom, XCB_ATOM_WINDOW, 0, 0xFFFF);
+    auto reply = xcb_get_property_reply(connection, cookie, nullptr);
+    if (!reply) {
+        return windowIds;
+    }
+
+    if (reply->format == 32) {
+        auto ids = static_cast<xcb_window_t*>(xcb_get_property_value(reply));
+        int length = xcb_get_property_value_length(reply) / 4;
+        for (int i = 0; i < length; i++) {
+            windowIds << WId(ids[i]);
+        }
+    }
+
+    free(reply);
+    return windowIds;
+}
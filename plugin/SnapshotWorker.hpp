@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QAtomicInteger>
+#include <QObject>
+#include <QScopedPointer>
+
+#include <xcb/xcb.h>
+
+#include "WindowSnapshot.hpp"
+#include "XcbWindowFetcher.hpp"
+
+// Builds window snapshots on its own thread, through its own connection
+// to the X server, so that waiting for replies never blocks the panel
+class SnapshotWorker : public QObject {
+    Q_OBJECT
+
+public:
+    SnapshotWorker(QObject* parent = nullptr);
+    ~SnapshotWorker();
+
+    // Called from the GUI thread before a request is sent, so that
+    // requests already waiting or being built can be given up
+    void supersede(quint64 serial);
+
+public slots:
+    void build(quint64 serial);
+
+signals:
+    void snapshotBuilt(WindowSnapshot snapshot);
+
+    // Sent instead when the worker can't connect to the X server
+    void snapshotFailed(quint64 serial);
+
+private:
+    QAtomicInteger<quint64> latestSerial;
+
+    xcb_connection_t* connection;
+    xcb_window_t rootWindow;
+    xcb_atom_t clientListAtom;
+    QScopedPointer<XcbWindowFetcher> windowFetcher;
+
+    // Connects on the first build, as it has to happen on the worker's thread
+    bool openConnection();
+    bool isSuperseded(quint64 serial) const;
+
+    QList<WId> fetchClientList();
+};
@@ -0,0 +1,76 @@
+#include "StateExporter.hpp"
+
+#include <QDBusConnection>
+#include <QDBusMetaType>
+
+static const QString statePath = "/VirtualDesktopBar/State";
+
+StateExporter::StateExporter(QObject* parent) : QObject(parent),
+        generation(0),
+        currentDesktop(0) {
+
+    // Desktop numbers go out as arrays of integers
+    qDBusRegisterMetaType<QList<int>>();
+
+    registered = QDBusConnection::sessionBus().registerObject(statePath, this,
+                                                              QDBusConnection::ExportScriptableSlots |
+                                                              QDBusConnection::ExportScriptableSignals);
+    if (!registered) {
+        qWarning("Cannot export the desktop state at %s", qPrintable(statePath));
+    }
+}
+
+StateExporter::~StateExporter() {
+    // Another exporter may hold the path, e.g. when this one failed to register
+    auto sessionBus = QDBusConnection::sessionBus();
+    if (registered && sessionBus.objectRegisteredAt(statePath) == this) {
+        sessionBus.unregisterObject(statePath);
+    }
+}
+
+void StateExporter::update(int newCurrentDesktop, const QStringList& newDesktopIds,
+                           const QStringList& newDesktopNames,
+                           const QList<int>& newOccupiedDesktops, const QList<int>& newUrgentDesktops) {
+    QVariantMap changes;
+
+    if (currentDesktop != newCurrentDesktop) {
+        currentDesktop = newCurrentDesktop;
+        changes.insert("currentDesktop", currentDesktop);
+    }
+    if (desktopIds != newDesktopIds) {
+        desktopIds = newDesktopIds;
+        changes.insert("desktopIds", desktopIds);
+    }
+    if (desktopNames != newDesktopNames) {
+        desktopNames = newDesktopNames;
+        changes.insert("desktopNames", desktopNames);
+    }
+    if (occupiedDesktops != newOccupiedDesktops) {
+        occupiedDesktops = newOccupiedDesktops;
+        changes.insert("occupiedDesktops", QVariant::fromValue(occupiedDesktops));
+    }
+    if (urgentDesktops != newUrgentDesktops) {
+        urgentDesktops = newUrgentDesktops;
+        changes.insert("urgentDesktops", QVariant::fromValue(urgentDesktops));
+    }
+
+    if (!changes.isEmpty()) {
+        generation++;
+        emit stateChanged(generation, changes);
+    }
+}
+
+qulonglong StateExporter::getGeneration() const {
+    return generation;
+}
+
+QVariantMap StateExporter::getState() const {
+    QVariantMap state;
+    state.insert("generation", generation);
+    state.insert("currentDesktop", currentDesktop);
+    state.insert("desktopIds", desktopIds);
+    state.insert("desktopNames", desktopNames);
+    state.insert("occupiedDesktops", QVariant::fromValue(occupiedDesktops));
+    state.insert("urgentDesktops", QVariant::fromValue(urgentDesktops));
+    return state;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QList>
+#include <QObject>
+#include <QStringList>
+#include <QVariantMap>
+
+// Makes the desktop state available at /VirtualDesktopBar/State on the session
+// bus, so that scripts and other bars can follow it instead of polling X;
+// the object is on the connection of the process showing the applet, i.e.
+// org.kde.plasmashell, and desktops are listed by their numbers
+class StateExporter : public QObject {
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.plasma.virtualdesktopbar.State")
+
+public:
+    StateExporter(QObject* parent = nullptr);
+    ~StateExporter();
+
+    // Called once per pass, a signal is emitted only when something has changed
+    void update(int currentDesktop, const QStringList& desktopIds, const QStringList& desktopNames,
+                const QList<int>& occupiedDesktops, const QList<int>& urgentDesktops);
+
+public slots:
+    // Grows by one with every change, so that a missed signal can be noticed
+    Q_SCRIPTABLE qulonglong getGeneration() const;
+
+    // All the fields of the state, along with the generation
+    Q_SCRIPTABLE QVariantMap getState() const;
+
+signals:
+    // Only the fields which changed since the previous generation are there
+    Q_SCRIPTABLE void stateChanged(qulonglong generation, QVariantMap changes);
+
+private:
+    bool registered;
+
+    qulonglong generation;
+    int currentDesktop;
+    QStringList desktopIds;
+    QStringList desktopNames;
+    QList<int> occupiedDesktops;
+    QList<int> urgentDesktops;
+};
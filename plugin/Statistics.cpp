@@ -0,0 +1,140 @@
+#include "Statistics.hpp"
+
+#include <QVariantList>
+
+Statistics& Statistics::get() {
+    static Statistics statistics;
+    return statistics;
+}
+
+Statistics::Statistics() {
+    reset();
+}
+
+void Statistics::increment(Counter counter, quint64 value) {
+    counters[counter].fetchAndAddRelaxed(value);
+}
+
+void Statistics::record(Histogram histogram, qint64 nanoseconds) {
+    quint64 microseconds = quint64(qMax<qint64>(0, nanoseconds / 1000));
+
+    int bucket = 0;
+    while (microseconds > 1 && bucket < bucketCount - 1) {
+        microseconds >>= 1;
+        bucket++;
+    }
+
+    histograms[histogram][bucket].fetchAndAddRelaxed(1);
+}
+
+void Statistics::recordPhase(Phase phase, qint64 nanoseconds) {
+    quint64 microseconds = quint64(qMax<qint64>(0, nanoseconds / 1000));
+
+    quint64 previous = phases[phase].load();
+    while (microseconds > previous && !phases[phase].testAndSetRelaxed(previous, microseconds)) {
+        previous = phases[phase].load();
+    }
+}
+
+QVariantMap Statistics::getCounters() const {
+    QVariantMap map;
+    for (int i = 0; i < CounterCount; i++) {
+        map.insert(getCounterName(Counter(i)), counters[i].load());
+    }
+    return map;
+}
+
+QVariantMap Statistics::getHistograms() const {
+    QVariantMap map;
+    for (int i = 0; i < HistogramCount; i++) {
+        QVariantList buckets;
+        for (int j = 0; j < bucketCount; j++) {
+            buckets << histograms[i][j].load();
+        }
+        map.insert(getHistogramName(Histogram(i)), buckets);
+    }
+    return map;
+}
+
+QVariantMap Statistics::getPhases() const {
+    QVariantMap map;
+    for (int i = 0; i < PhaseCount; i++) {
+        map.insert(getPhaseName(Phase(i)), phases[i].load());
+    }
+    return map;
+}
+
+void Statistics::reset() {
+    for (int i = 0; i < CounterCount; i++) {
+        counters[i].store(0);
+    }
+    for (int i = 0; i < HistogramCount; i++) {
+        for (int j = 0; j < bucketCount; j++) {
+            histograms[i][j].store(0);
+        }
+    }
+}
+
+qint64 Statistics::getPercentile(Histogram histogram, int percent) const {
+    quint64 total = 0;
+    for (int i = 0; i < bucketCount; i++) {
+        total += histograms[histogram][i].load();
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    quint64 threshold = (total * quint64(percent) + 99) / 100;
+    quint64 count = 0;
+    for (int i = 0; i < bucketCount; i++) {
+        count += histograms[histogram][i].load();
+        if (count >= threshold) {
+            return qint64(1) << (i + 1);
+        }
+    }
+    return qint64(1) << bucketCount;
+}
+
+QString Statistics::getCounterName(Counter counter) {
+    switch (counter) {
+        case WindowInfoFetches: return "windowInfoFetches";
+        case WindowListFetches: return "windowListFetches";
+        case SnapshotsSuperseded: return "snapshotsSuperseded";
+        case DBusCalls: return "dbusCalls";
+        case DBusErrors: return "dbusErrors";
+        case RefreshPasses: return "refreshPasses";
+        case SlowRefreshes: return "slowRefreshes";
+        case TriggersFromDesktops: return "triggersFromDesktops";
+        case TriggersFromOccupancy: return "triggersFromOccupancy";
+        case TriggersFromScreens: return "triggersFromScreens";
+        case TriggersFromWindowInfo: return "triggersFromWindowInfo";
+        case TriggersFromConfiguration: return "triggersFromConfiguration";
+        case TriggersFromApplet: return "triggersFromApplet";
+        case AutomationDesktopsAdded: return "automationDesktopsAdded";
+        case AutomationDesktopsRemoved: return "automationDesktopsRemoved";
+        case AutomationDesktopsRenamed: return "automationDesktopsRenamed";
+        case AutomationWindowRulesApplied: return "automationWindowRulesApplied";
+        case CounterCount: break;
+    }
+    return QString();
+}
+
+QString Statistics::getHistogramName(Histogram histogram) {
+    switch (histogram) {
+        case RefreshDuration: return "refreshDuration";
+        case DBusLatency: return "dbusLatency";
+        case HistogramCount: break;
+    }
+    return QString();
+}
+
+QString Statistics::getPhaseName(Phase phase) {
+    switch (phase) {
+        case EngineSetUp: return "engineSetUp";
+        case WindowScan: return "windowScan";
+        case ShortcutRegistration: return "shortcutRegistration";
+        case FirstPaint: return "firstPaint";
+        case PhaseCount: break;
+    }
+    return QString();
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QAtomicInteger>
+#include <QString>
+#include <QVariantMap>
+
+// Process-wide counters and histograms, cheap enough to be always on,
+// as recording is just a relaxed atomic increment
+class Statistics {
+public:
+    enum Counter {
+        WindowInfoFetches,
+        WindowListFetches,
+        SnapshotsSuperseded,
+        DBusCalls,
+        DBusErrors,
+        RefreshPasses,
+        SlowRefreshes,
+        TriggersFromDesktops,
+        TriggersFromOccupancy,
+        TriggersFromScreens,
+        TriggersFromWindowInfo,
+        TriggersFromConfiguration,
+        TriggersFromApplet,
+        // Actions taken by the automation
+        AutomationDesktopsAdded,
+        AutomationDesktopsRemoved,
+        AutomationDesktopsRenamed,
+        AutomationWindowRulesApplied,
+        CounterCount
+    };
+
+    enum Histogram {
+        RefreshDuration,
+        DBusLatency,
+        HistogramCount
+    };
+
+    // Steps of the startup, each measured once per process
+    enum Phase {
+        EngineSetUp,
+        WindowScan,
+        ShortcutRegistration,
+        FirstPaint,
+        PhaseCount
+    };
+
+    // Bucket N counts durations from 2^N to 2^(N+1) microseconds,
+    // and the last one everything longer than that
+    static const int bucketCount = 20;
+
+    static Statistics& get();
+
+    void increment(Counter counter, quint64 value = 1);
+    void record(Histogram histogram, qint64 nanoseconds);
+
+    // With many applets the slowest one is kept
+    void recordPhase(Phase phase, qint64 nanoseconds);
+
+    QVariantMap getCounters() const;
+    QVariantMap getHistograms() const;
+
+    // Durations in microseconds, left alone by a reset
+    QVariantMap getPhases() const;
+    void reset();
+
+    // Upper bound of the bucket in which the given share of samples falls
+    qint64 getPercentile(Histogram histogram, int percent) const;
+
+private:
+    Statistics();
+
+    QAtomicInteger<quint64> counters[CounterCount];
+    QAtomicInteger<quint64> histograms[HistogramCount][bucketCount];
+    QAtomicInteger<quint64> phases[PhaseCount];
+
+    static QString getCounterName(Counter counter);
+    static QString getHistogramName(Histogram histogram);
+    static QString getPhaseName(Phase phase);
+};
@@ -0,0 +1,39 @@
+#include "StatisticsExporter.hpp"
+
+#include <QDBusConnection>
+
+#include "Statistics.hpp"
+
+static const QString statisticsPath = "/VirtualDesktopBar/Stats";
+
+StatisticsExporter::StatisticsExporter(QObject* parent) : QObject(parent) {
+    registered = QDBusConnection::sessionBus().registerObject(statisticsPath, this,
+                                                              QDBusConnection::ExportScriptableSlots);
+    if (!registered) {
+        qWarning("Cannot export the statistics at %s", qPrintable(statisticsPath));
+    }
+}
+
+StatisticsExporter::~StatisticsExporter() {
+    // Another exporter may hold the path, e.g. when this one failed to register
+    auto sessionBus = QDBusConnection::sessionBus();
+    if (registered && sessionBus.objectRegisteredAt(statisticsPath) == this) {
+        sessionBus.unregisterObject(statisticsPath);
+    }
+}
+
+QVariantMap StatisticsExporter::getCounters() const {
+    return Statistics::get().getCounters();
+}
+
+QVariantMap StatisticsExporter::getHistograms() const {
+    return Statistics::get().getHistograms();
+}
+
+QVariantMap StatisticsExporter::getPhases() const {
+    return Statistics::get().getPhases();
+}
+
+void StatisticsExporter::reset() {
+    Statistics::get().reset();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QObject>
+#include <QVariantMap>
+
+// Makes the statistics available at /VirtualDesktopBar/Stats on the session bus
+class StatisticsExporter : public QObject {
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.plasma.virtualdesktopbar.Stats")
+
+public:
+    StatisticsExporter(QObject* parent = nullptr);
+    ~StatisticsExporter();
+
+public slots:
+    Q_SCRIPTABLE QVariantMap getCounters() const;
+
+    // Each histogram is a list of bucket counts, see Statistics
+    Q_SCRIPTABLE QVariantMap getHistograms() const;
+
+    // Durations of the startup phases in microseconds
+    Q_SCRIPTABLE QVariantMap getPhases() const;
+
+    Q_SCRIPTABLE void reset();
+
+private:
+    bool registered;
+};
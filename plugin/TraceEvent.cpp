@@ -0,0 +1,134 @@
+#include "TraceEvent.hpp"
+
+static void writeWindowInfo(QDataStream& stream, const WindowInfo& windowInfo, NET::Properties properties) {
+    stream << quint64(windowInfo.id);
+    if (properties & NET::WMDesktop) {
+        stream << qint32(windowInfo.desktop);
+    }
+    if (properties & NET::WMState) {
+        stream << quint32(windowInfo.state);
+    }
+    if (properties & NET::WMWindowType) {
+        stream << qint32(windowInfo.type) << windowInfo.windowClass;
+    }
+    if (properties & NET::WMGeometry) {
+        stream << windowInfo.geometry;
+    }
+    if (properties & NET::WMName) {
+        stream << windowInfo.name;
+    }
+}
+
+static void readWindowInfo(QDataStream& stream, WindowInfo& windowInfo, NET::Properties properties) {
+    quint64 id;
+    stream >> id;
+    windowInfo.id = WId(id);
+
+    if (properties & NET::WMDesktop) {
+        qint32 desktop;
+        stream >> desktop;
+        windowInfo.desktop = desktop;
+    }
+    if (properties & NET::WMState) {
+        quint32 state;
+        stream >> state;
+        windowInfo.state = NET::States(state);
+    }
+    if (properties & NET::WMWindowType) {
+        qint32 type;
+        stream >> type;
+        windowInfo.type = NET::WindowType(type);
+        stream >> windowInfo.windowClass;
+    }
+    if (properties & NET::WMGeometry) {
+        stream >> windowInfo.geometry;
+    }
+    if (properties & NET::WMName) {
+        stream >> windowInfo.name;
+    }
+}
+
+static const NET::Properties allWindowProperties = NET::WMDesktop | NET::WMState | NET::WMWindowType |
+                                                   NET::WMGeometry | NET::WMName;
+
+QDataStream& operator<<(QDataStream& stream, const TraceEvent& event) {
+    stream << event.time << quint8(event.type);
+
+    switch (event.type) {
+        case TraceEvent::Snapshot:
+            stream << qint32(event.number) << event.desktopNameList;
+            stream << qint32(event.windowInfoList.length());
+            for (auto& windowInfo : event.windowInfoList) {
+                writeWindowInfo(stream, windowInfo, allWindowProperties);
+            }
+            break;
+        case TraceEvent::NumberOfDesktopsChanged:
+        case TraceEvent::CurrentDesktopChanged:
+            stream << qint32(event.number);
+            break;
+        case TraceEvent::DesktopNamesChanged:
+            stream << event.desktopNameList;
+            break;
+        case TraceEvent::WindowAdded:
+            writeWindowInfo(stream, event.windowInfo, allWindowProperties);
+            break;
+        case TraceEvent::WindowRemoved:
+            stream << quint64(event.windowInfo.id);
+            break;
+        case TraceEvent::WindowChanged:
+            stream << quint32(event.properties);
+            writeWindowInfo(stream, event.windowInfo, event.properties);
+            break;
+    }
+
+    return stream;
+}
+
+QDataStream& operator>>(QDataStream& stream, TraceEvent& event) {
+    quint8 type;
+    stream >> event.time >> type;
+    event.type = TraceEvent::Type(type);
+
+    qint32 number;
+    quint64 id;
+    quint32 properties;
+
+    switch (event.type) {
+        case TraceEvent::Snapshot:
+            stream >> number >> event.desktopNameList;
+            event.number = number;
+            stream >> number;
+            event.windowInfoList.clear();
+            for (int i = 0; i < number && stream.status() == QDataStream::Ok; i++) {
+                WindowInfo windowInfo;
+                readWindowInfo(stream, windowInfo, allWindowProperties);
+                event.windowInfoList << windowInfo;
+            }
+            break;
+        case TraceEvent::NumberOfDesktopsChanged:
+        case TraceEvent::CurrentDesktopChanged:
+            stream >> number;
+            event.number = number;
+            break;
+        case TraceEvent::DesktopNamesChanged:
+            stream >> event.desktopNameList;
+            break;
+        case TraceEvent::WindowAdded:
+            readWindowInfo(stream, event.windowInfo, allWindowProperties);
+            break;
+        case TraceEvent::WindowRemoved:
+            stream >> id;
+            event.windowInfo.id = WId(id);
+            break;
+        case TraceEvent::WindowChanged:
+            stream >> properties;
+            event.properties = NET::Properties(properties);
+            readWindowInfo(stream, event.windowInfo, event.properties);
+            break;
+        default:
+            stream.setStatus(QDataStream::ReadCorruptData);
+            break;
+    }
+
+    return stream;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QDataStream>
+#include <QList>
+#include <QString>
+
+#include <netwm_def.h>
+
+#include "WindowInfo.hpp"
+
+// A single event received from the window system, as stored in a trace
+class TraceEvent {
+public:
+    enum Type : quint8 {
+        Snapshot = 1,
+        NumberOfDesktopsChanged,
+        CurrentDesktopChanged,
+        DesktopNamesChanged,
+        WindowAdded,
+        WindowRemoved,
+        WindowChanged
+    };
+
+    static const quint32 magic = 0x56444254; // "VDBT"
+    static const quint16 version = 2;
+
+    // Nanoseconds since the recording started
+    qint64 time = 0;
+    Type type = Snapshot;
+
+    int number = 0;
+    QList<QString> desktopNameList;
+
+    NET::Properties properties;
+    WindowInfo windowInfo;
+    QList<WindowInfo> windowInfoList;
+};
+
+// Only the fields which belong to the event's type are written
+QDataStream& operator<<(QDataStream& stream, const TraceEvent& event);
+QDataStream& operator>>(QDataStream& stream, TraceEvent& event);
@@ -0,0 +1,90 @@
+#include "TraceRecorder.hpp"
+
+#include "WindowIndex.hpp"
+
+TraceRecorder::TraceRecorder(WindowSystemBackend* backend, const QString& filePath, QObject* parent) :
+        QObject(parent),
+        backend(backend),
+        file(filePath) {
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("Cannot record a trace to %s: %s", qPrintable(filePath), qPrintable(file.errorString()));
+        return;
+    }
+
+    stream.setDevice(&file);
+    stream.setVersion(QDataStream::Qt_5_9);
+    stream << TraceEvent::magic << TraceEvent::version;
+
+    timer.start();
+    writeSnapshot();
+    setUpSignals();
+}
+
+void TraceRecorder::setUpSignals() {
+    QObject::connect(backend, &WindowSystemBackend::numberOfDesktopsChanged, this, [&](int number) {
+        TraceEvent event;
+        event.type = TraceEvent::NumberOfDesktopsChanged;
+        event.number = number;
+        writeEvent(event);
+    });
+
+    QObject::connect(backend, &WindowSystemBackend::currentDesktopChanged, this, [&](int number) {
+        TraceEvent event;
+        event.type = TraceEvent::CurrentDesktopChanged;
+        event.number = number;
+        writeEvent(event);
+    });
+
+    QObject::connect(backend, &WindowSystemBackend::desktopNamesChanged, this, [&] {
+        TraceEvent event;
+        event.type = TraceEvent::DesktopNamesChanged;
+        for (int i = 1; i <= backend->numberOfDesktops(); i++) {
+            event.desktopNameList << backend->desktopName(i);
+        }
+        writeEvent(event);
+    });
+
+    QObject::connect(backend, &WindowSystemBackend::windowAdded, this, [&](WId id) {
+        TraceEvent event;
+        event.type = TraceEvent::WindowAdded;
+        if (backend->fetchWindowInfo(id, WindowIndex::trackedProperties, event.windowInfo)) {
+            writeEvent(event);
+        }
+    });
+
+    QObject::connect(backend, &WindowSystemBackend::windowRemoved, this, [&](WId id) {
+        TraceEvent event;
+        event.type = TraceEvent::WindowRemoved;
+        event.windowInfo.id = id;
+        writeEvent(event);
+    });
+
+    QObject::connect(backend, &WindowSystemBackend::windowChanged, this, [&](WId id, NET::Properties properties) {
+        TraceEvent event;
+        event.type = TraceEvent::WindowChanged;
+        event.properties = properties & WindowIndex::trackedProperties;
+        if (event.properties && backend->fetchWindowInfo(id, event.properties, event.windowInfo)) {
+            writeEvent(event);
+        }
+    });
+}
+
+void TraceRecorder::writeSnapshot() {
+    TraceEvent event;
+    event.type = TraceEvent::Snapshot;
+    event.number = backend->currentDesktop();
+    for (int i = 1; i <= backend->numberOfDesktops(); i++) {
+        event.desktopNameList << backend->desktopName(i);
+    }
+    event.windowInfoList = backend->fetchWindowInfoList(backend->stackingOrder());
+    writeEvent(event);
+}
+
+void TraceRecorder::writeEvent(TraceEvent& event) {
+    event.time = timer.nsecsElapsed();
+    stream << event;
+
+    // Whatever happened until a stall or a crash is what matters most
+    file.flush();
+}
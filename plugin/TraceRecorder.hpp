@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QObject>
+#include <QString>
+
+#include "TraceEvent.hpp"
+#include "WindowSystemBackend.hpp"
+
+// Writes every event coming from the backend to a binary trace file,
+// starting with a snapshot of the whole state, so it can be replayed
+// later against the simulated backend
+class TraceRecorder : public QObject {
+    Q_OBJECT
+
+public:
+    TraceRecorder(WindowSystemBackend* backend, const QString& filePath, QObject* parent = nullptr);
+
+private:
+    WindowSystemBackend* backend;
+
+    QFile file;
+    QDataStream stream;
+    QElapsedTimer timer;
+
+    void setUpSignals();
+
+    void writeSnapshot();
+    void writeEvent(TraceEvent& event);
+};
@@ -0,0 +1,178 @@
+#include "TraceReplayer.hpp"
+
+#include <algorithm>
+
+#include <QDataStream>
+#include <QFile>
+
+// How long to wait for the last refreshes after the last event
+static const int settleTime = 1000;
+
+TraceReplayer::TraceReplayer(SimulatedBackend* backend, const ChangeScheduler* changeScheduler,
+                             const QString& filePath, double speed, QObject* parent) :
+        QObject(parent),
+        backend(backend),
+        changeScheduler(changeScheduler),
+        speed(qMax(0.0, speed)),
+        loaded(false),
+        nextEventIndex(0),
+        initialExecutedCount(0),
+        initialCoalescedCount(0) {
+
+    loaded = load(filePath);
+    if (!loaded) {
+        return;
+    }
+
+    timer.setSingleShot(true);
+    setUpSignals();
+
+    // Starting once the applet is up and running
+    timer.start(0);
+}
+
+bool TraceReplayer::isLoaded() const {
+    return loaded;
+}
+
+bool TraceReplayer::load(const QString& filePath) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning("Cannot replay the trace from %s: %s", qPrintable(filePath), qPrintable(file.errorString()));
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_9);
+
+    quint32 magic;
+    quint16 version;
+    stream >> magic >> version;
+    if (magic != TraceEvent::magic || version != TraceEvent::version) {
+        qWarning("Cannot replay the trace from %s: unknown format", qPrintable(filePath));
+        return false;
+    }
+
+    while (!stream.atEnd()) {
+        TraceEvent event;
+        stream >> event;
+        if (stream.status() != QDataStream::Ok) {
+            // A trace cut short by a crash is still worth replaying
+            qWarning("The trace from %s is truncated after %d events", qPrintable(filePath), eventList.length());
+            break;
+        }
+        eventList << event;
+    }
+
+    return true;
+}
+
+void TraceReplayer::setUpSignals() {
+    QObject::connect(&timer, &QTimer::timeout, this, [&] {
+        replayNextEvent();
+    });
+
+    QObject::connect(changeScheduler, &ChangeScheduler::passTriggered, this, [&] {
+        // Connected after the engine, so the pass is already done here
+        qint64 now = replayTimer.nsecsElapsed();
+        for (qint64 time : pendingEventTimeList) {
+            latencyList << now - time;
+        }
+        pendingEventTimeList.clear();
+    });
+}
+
+void TraceReplayer::replayNextEvent() {
+    if (nextEventIndex == 0) {
+        replayTimer.start();
+        initialExecutedCount = changeScheduler->getExecutedCount();
+        initialCoalescedCount = changeScheduler->getCoalescedCount();
+    }
+
+    if (nextEventIndex >= eventList.length()) {
+        report();
+        return;
+    }
+
+    auto& event = eventList[nextEventIndex++];
+    replayEvent(event);
+
+    // The snapshot only sets the stage, so it's not measured
+    if (event.type != TraceEvent::Snapshot) {
+        pendingEventTimeList << replayTimer.nsecsElapsed();
+    }
+
+    if (nextEventIndex >= eventList.length()) {
+        timer.start(settleTime);
+        return;
+    }
+
+    qint64 delay = 0;
+    if (speed > 0) {
+        qint64 eventTime = qint64((eventList[nextEventIndex].time - eventList[1].time) / speed);
+        delay = qMax<qint64>(0, eventTime - replayTimer.nsecsElapsed()) / 1000000;
+    }
+    timer.start(int(delay));
+}
+
+void TraceReplayer::replayEvent(const TraceEvent& event) {
+    switch (event.type) {
+        case TraceEvent::Snapshot:
+            for (WId id : backend->windows()) {
+                backend->destroyWindow(id);
+            }
+            backend->setNumberOfDesktops(event.desktopNameList.length());
+            for (int i = 0; i < event.desktopNameList.length(); i++) {
+                backend->setDesktopName(i + 1, event.desktopNameList[i]);
+            }
+            backend->setCurrentDesktop(event.number);
+            for (auto& windowInfo : event.windowInfoList) {
+                backend->insertWindow(windowInfo);
+            }
+            break;
+        case TraceEvent::NumberOfDesktopsChanged:
+            backend->setNumberOfDesktops(event.number);
+            break;
+        case TraceEvent::CurrentDesktopChanged:
+            backend->setCurrentDesktop(event.number);
+            break;
+        case TraceEvent::DesktopNamesChanged:
+            for (int i = 0; i < event.desktopNameList.length(); i++) {
+                backend->setDesktopName(i + 1, event.desktopNameList[i]);
+            }
+            break;
+        case TraceEvent::WindowAdded:
+            backend->insertWindow(event.windowInfo);
+            break;
+        case TraceEvent::WindowRemoved:
+            backend->destroyWindow(event.windowInfo.id);
+            break;
+        case TraceEvent::WindowChanged:
+            backend->updateWindow(event.windowInfo, event.properties);
+            break;
+    }
+}
+
+void TraceReplayer::report() {
+    QVector<qint64> sortedLatencyList = latencyList;
+    std::sort(sortedLatencyList.begin(), sortedLatencyList.end());
+
+    auto percentile = [&](int p) -> qint64 {
+        if (sortedLatencyList.isEmpty()) {
+            return 0;
+        }
+        int i = qMin(sortedLatencyList.size() - 1, sortedLatencyList.size() * p / 100);
+        return sortedLatencyList[i] / 1000;
+    };
+
+    qInfo("Replayed %d events in %lld ms, %d still waiting for a refresh",
+          qMax(0, eventList.length() - 1), replayTimer.elapsed() - settleTime, pendingEventTimeList.size());
+    qInfo("Latency in us: p50 %lld, p90 %lld, p99 %lld, max %lld",
+          percentile(50), percentile(90), percentile(99),
+          sortedLatencyList.isEmpty() ? 0 : sortedLatencyList.last() / 1000);
+    qInfo("Refresh passes: %llu executed, %llu coalesced",
+          changeScheduler->getExecutedCount() - initialExecutedCount,
+          changeScheduler->getCoalescedCount() - initialCoalescedCount);
+
+    emit finished();
+}
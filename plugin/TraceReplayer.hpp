@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+#include "ChangeScheduler.hpp"
+#include "SimulatedBackend.hpp"
+#include "TraceEvent.hpp"
+
+// Feeds a recorded trace into the simulated backend and measures how long
+// it takes for each event to be reflected by a refresh pass. The results
+// are logged once the whole trace has been replayed, and then it's finished
+class TraceReplayer : public QObject {
+    Q_OBJECT
+
+public:
+    // Speed 2 replays twice as fast as recorded, 0 replays without pauses
+    TraceReplayer(SimulatedBackend* backend, const ChangeScheduler* changeScheduler,
+                  const QString& filePath, double speed = 1, QObject* parent = nullptr);
+
+    // Nothing is replayed when the trace can't be read
+    bool isLoaded() const;
+
+signals:
+    void finished();
+
+private:
+    SimulatedBackend* backend;
+    const ChangeScheduler* changeScheduler;
+    double speed;
+
+    bool loaded;
+    QList<TraceEvent> eventList;
+    int nextEventIndex;
+
+    QTimer timer;
+    QElapsedTimer replayTimer;
+
+    QVector<qint64> pendingEventTimeList;
+    QVector<qint64> latencyList;
+    quint64 initialExecutedCount;
+    quint64 initialCoalescedCount;
+
+    bool load(const QString& filePath);
+    void setUpSignals();
+
+    void replayNextEvent();
+    void replayEvent(const TraceEvent& event);
+    void report();
+};
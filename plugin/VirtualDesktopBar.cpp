@@ -1,447 +1,498 @@
 #include "VirtualDesktopBar.hpp"
 
-#include <functional>
+#include "Statistics.hpp"
 
-#include <QGuiApplication>
-#include <QRegularExpression>
-#include <QScreen>
-#include <QTimer>
-#include <QX11Info>
+// How often a refresh over the budget may be logged
+static const int slowRefreshLogInterval = 10000;
 
-#include <KGlobalAccel>
+// Changes are written to the cache at most this often
+static const int cacheSaveInterval = 2000;
+
+static QElapsedTimer startTimer() {
+    QElapsedTimer timer;
+    timer.start();
+    return timer;
+}
 
 VirtualDesktopBar::VirtualDesktopBar(QObject* parent) : QObject(parent),
-        netRootInfo(QX11Info::connection(), 0),
-        dbusInterface("org.kde.KWin", "/VirtualDesktopManager"),
-        dbusInterfaceName("org.kde.KWin.VirtualDesktopManager"),
-        sendDesktopInfoListLock(false),
-        tryAddEmptyDesktopLock(false),
-        tryRemoveEmptyDesktopsLock(false),
-        tryRenameEmptyDesktopsLock(false),
-        currentDesktopNumber(KWindowSystem::currentDesktop()),
-        mostRecentDesktopNumber(currentDesktopNumber) {
+        firstPaintTimer(startTimer()),
+        engine(VirtualDesktopBarEngine::getInstance()),
+        previewingDesktopMove(false),
+        screenIndex(0),
+        cfg_DynamicDesktopsEnable(false),
+        cfg_MultipleScreensFilterOccupiedDesktops(false),
+        cfg_MultipleScreensEnableSeparateDesktops(false),
+        cfg_DesktopLabelsStyle(0),
+        cfg_DesktopLabelsMaximumLength(25),
+        cfg_DesktopLabelsDisplayAsUppercased(false),
+        cfg_RefreshMinimumInterval(0),
+        cfg_RefreshMaximumLatency(100),
+        cfg_RefreshBudget(4),
+        cfg_StartupBudget(500),
+        cfg_KWinLatencyBudget(500),
+        suppressedSlowRefreshCount(0) {
+
+    cacheSaveTimer.setSingleShot(true);
+    cacheSaveTimer.setInterval(cacheSaveInterval);
 
     setUpSignals();
-    setUpGlobalKeyboardShortcuts();
+    claimAutomation();
 }
 
-void VirtualDesktopBar::requestDesktopInfoList() {
-    sendDesktopInfoList();
+VirtualDesktopBar::~VirtualDesktopBar() {
+    if (cacheSaveTimer.isActive()) {
+        desktopCache.save(desktopListModel.getDesktopInfoList());
+    }
+    if (previewingDesktopMove) {
+        engine->releaseChanges();
+    }
+
+    // Otherwise this applet would be the first to claim the automation back
+    QObject::disconnect(engine.data(), nullptr, this, nullptr);
+    engine->releaseAutomation(this);
+    engine->setWindowNamesShown(this, false);
 }
 
-void VirtualDesktopBar::showDesktop(int number) {
-    KWindowSystem::setCurrentDesktop(number);
+DesktopListModel* VirtualDesktopBar::getDesktopListModel() {
+    return &desktopListModel;
 }
 
-void VirtualDesktopBar::addDesktop(unsigned /*position*/) {
-    netRootInfo.setNumberOfDesktops(KWindowSystem::numberOfDesktops() + 1);
+void VirtualDesktopBar::requestDesktopInfoList() {
+    sendDesktopInfoList();
+}
 
-    if (!cfg_AddingDesktopsExecuteCommand.isEmpty()) {
-        QTimer::singleShot(100, [=] {
-            QString command = "(" + cfg_AddingDesktopsExecuteCommand + ") &";
-            system(command.toStdString().c_str());
-        });
+void VirtualDesktopBar::reportDesktopButtonsPopulated(QObject* window) {
+    if (!firstPaintTimer.isValid()) {
+        return;
     }
-}
 
-void VirtualDesktopBar::removeDesktop(int number) {
-    auto reply = dbusInterface.call("removeDesktop", getDesktopInfo(number).id);
-
-    if (reply.type() == QDBusMessage::ErrorMessage) {
-        if (number == KWindowSystem::numberOfDesktops()) {
-            netRootInfo.setNumberOfDesktops(KWindowSystem::numberOfDesktops() - 1);
-        } else {
-            tryAddEmptyDesktopLock = true;
-            tryRemoveEmptyDesktopsLock = true;
-            tryRenameEmptyDesktopsLock = true;
-            sendDesktopInfoListLock = true;
-
-            QList<QString> desktopNameList;
-            QList<KWindowInfo> windowInfoList;
-            for (int i = number + 1; i <= KWindowSystem::numberOfDesktops(); i++) {
-                desktopNameList << KWindowSystem::desktopName(i);
-                windowInfoList.append(getWindowInfoList(i));
-            }
+    // The window isn't known to this plugin by its type, and the signal
+    // may come from the render thread
+    if (!window || !QObject::connect(window, SIGNAL(frameSwapped()), this, SLOT(reportFirstPaint()),
+                                     Qt::QueuedConnection)) {
+        reportFirstPaint();
+    }
+}
 
-            for (int i = number, j = 0; i <= KWindowSystem::numberOfDesktops() - 1; i++, j++) {
-                renameDesktop(i, desktopNameList[j]);
-            }
+void VirtualDesktopBar::reportFirstPaint() {
+    if (sender()) {
+        QObject::disconnect(sender(), SIGNAL(frameSwapped()), this, SLOT(reportFirstPaint()));
+    }
 
-            for (auto& windowInfo : windowInfoList) {
-                KWindowSystem::setOnDesktop(windowInfo.win(), windowInfo.desktop() - 1);
-            }
+    if (!firstPaintTimer.isValid()) {
+        return;
+    }
 
-            tryAddEmptyDesktopLock = false;
-            tryRemoveEmptyDesktopsLock = false;
-            tryRenameEmptyDesktopsLock = false;
-            sendDesktopInfoListLock = false;
+    qint64 nanoseconds = firstPaintTimer.nsecsElapsed();
+    firstPaintTimer.invalidate();
 
-            netRootInfo.setNumberOfDesktops(KWindowSystem::numberOfDesktops() - 1);
-        }
+    Statistics::get().recordPhase(Statistics::FirstPaint, nanoseconds);
+    if (cfg_StartupBudget > 0 && nanoseconds > qint64(cfg_StartupBudget) * 1000000) {
+        qWarning("Desktop buttons took %lld us to show up, over the budget of %d ms",
+                 nanoseconds / 1000, cfg_StartupBudget);
     }
+
+    // Windows are scanned only now, so that they don't hold back the buttons
+    QTimer::singleShot(0, engine.data(), &VirtualDesktopBarEngine::finishStartup);
 }
 
-void VirtualDesktopBar::renameDesktop(int number, QString name) {
-    auto reply = dbusInterface.call("setDesktopName", getDesktopInfo(number).id, name);
+QVariantMap VirtualDesktopBar::getRefreshStatistics() {
+    QVariantMap statistics;
+    statistics.insert("coalescedPasses", engine->getChangeScheduler().getCoalescedCount());
+    statistics.insert("executedPasses", engine->getChangeScheduler().getExecutedCount());
+    return statistics;
+}
 
-    if (reply.type() == QDBusMessage::ErrorMessage) {
-        KWindowSystem::setDesktopName(number, name);
+QVariantMap VirtualDesktopBar::getStatistics() {
+    auto& statistics = Statistics::get();
+    auto map = statistics.getCounters();
+    map.insert("refreshDurationP50", statistics.getPercentile(Statistics::RefreshDuration, 50));
+    map.insert("refreshDurationP99", statistics.getPercentile(Statistics::RefreshDuration, 99));
+    map.insert("dbusLatencyP50", statistics.getPercentile(Statistics::DBusLatency, 50));
+    map.insert("dbusLatencyP99", statistics.getPercentile(Statistics::DBusLatency, 99));
+
+    auto phases = statistics.getPhases();
+    for (auto it = phases.constBegin(); it != phases.constEnd(); ++it) {
+        map.insert(it.key(), it.value());
     }
+    return map;
 }
 
-void VirtualDesktopBar::replaceDesktops(int number1, int number2) {
-    if (number1 == number2) {
-        return;
-    }
-    if (number1 < 1 || number1 > KWindowSystem::numberOfDesktops()) {
-        return;
-    }
-    if (number2 < 1 || number2 > KWindowSystem::numberOfDesktops()) {
-        return;
+QStringList VirtualDesktopBar::getWindowNameList(int number) {
+    QStringList windowNameList;
+    for (auto& windowInfo : getWindowInfoList(number)) {
+        windowNameList << windowInfo.shortName;
     }
+    return windowNameList;
+}
+
+void VirtualDesktopBar::showDesktop(int number) {
+    engine->showDesktop(number);
+}
+
+void VirtualDesktopBar::switchDesktopBy(int steps, bool wrap) {
+    engine->switchDesktopBy(steps, wrap);
+}
+
+void VirtualDesktopBar::addDesktop(unsigned /*position*/) {
+    engine->addDesktop();
+}
+
+void VirtualDesktopBar::removeDesktop(int number) {
+    engine->removeDesktops({ number });
+}
 
-    auto desktopInfo1 = getDesktopInfo(number1);
-    auto desktopInfo2 = getDesktopInfo(number2);
+void VirtualDesktopBar::removeDesktops(QList<int> numbers) {
+    engine->removeDesktops(numbers);
+}
 
-    auto windowInfoList1 = getWindowInfoList(desktopInfo1.number);
-    auto windowInfoList2 = getWindowInfoList(desktopInfo2.number);
+void VirtualDesktopBar::renameDesktop(int number, QString name) {
+    engine->renameDesktop(number, name);
+}
 
-    if (desktopInfo1.isCurrent) {
-        KWindowSystem::setCurrentDesktop(desktopInfo2.number);
-    } else if (desktopInfo2.isCurrent) {
-        KWindowSystem::setCurrentDesktop(desktopInfo1.number);
+void VirtualDesktopBar::previewMoveDesktop(int fromNumber, int toNumber) {
+    // Refreshes would bring the model back to the real order
+    if (!previewingDesktopMove) {
+        previewingDesktopMove = true;
+        engine->holdChanges();
     }
 
-    for (auto& windowInfo : windowInfoList2) {
-        KWindowSystem::setOnDesktop(windowInfo.win(), desktopInfo1.number);
+    desktopListModel.move(fromNumber - 1, toNumber - 1);
+
+    // Labels may show numbers, which the move has just changed
+    auto desktopInfoList = desktopListModel.getDesktopInfoList();
+    updateLabels(desktopInfoList);
+    desktopListModel.update(desktopInfoList);
+}
+
+void VirtualDesktopBar::moveDesktop(int fromNumber, int toNumber) {
+    engine->moveDesktop(fromNumber, toNumber);
+
+    if (previewingDesktopMove) {
+        previewingDesktopMove = false;
+        engine->scheduleRefresh();
+        engine->releaseChanges();
     }
+}
 
-    for (auto& windowInfo : windowInfoList1) {
-        KWindowSystem::setOnDesktop(windowInfo.win(), desktopInfo2.number);
+void VirtualDesktopBar::cancelMoveDesktop() {
+    if (!previewingDesktopMove) {
+        return;
     }
 
-    renameDesktop(desktopInfo1.number, desktopInfo2.name);
-    renameDesktop(desktopInfo2.number, desktopInfo1.name);
+    // The model goes back to the real order right away
+    previewingDesktopMove = false;
+    sendDesktopInfoList();
+    engine->releaseChanges();
 }
 
 void VirtualDesktopBar::setUpSignals() {
-    setUpKWinSignals();
+    setUpEngineSignals();
     setUpInternalSignals();
 }
 
-void VirtualDesktopBar::setUpKWinSignals() {
-    QObject::connect(KWindowSystem::self(), &KWindowSystem::currentDesktopChanged, this, [&] {
-        updateLocalDesktopNumbers();
-        processChanges([&] { sendDesktopInfoList(); }, sendDesktopInfoListLock);
+void VirtualDesktopBar::setUpEngineSignals() {
+    QObject::connect(engine.data(), &VirtualDesktopBarEngine::refreshRequested, this, [&] {
+        sendDesktopInfoList();
     });
 
-    QObject::connect(KWindowSystem::self(), &KWindowSystem::numberOfDesktopsChanged, this, [&] {
-        processChanges([&] { tryAddEmptyDesktop(); }, tryAddEmptyDesktopLock);
-        processChanges([&] { tryRemoveEmptyDesktops(); }, tryRemoveEmptyDesktopsLock);
-        processChanges([&] { tryRenameEmptyDesktops(); }, tryRenameEmptyDesktopsLock);
-        processChanges([&] { sendDesktopInfoList(); }, sendDesktopInfoListLock);
+    QObject::connect(engine.data(), &VirtualDesktopBarEngine::currentDesktopChanged, this, [&](int oldNumber, int newNumber) {
+        // Previewed rows don't match the real desktops, a refresh follows anyway
+        if (!previewingDesktopMove) {
+            desktopListModel.setCurrent(oldNumber, newNumber);
+        }
+        emit currentDesktopChanged(oldNumber, newNumber);
     });
 
-    QObject::connect(KWindowSystem::self(), &KWindowSystem::desktopNamesChanged, this, [&] {
-        processChanges([&] { sendDesktopInfoList(); }, sendDesktopInfoListLock);
+    QObject::connect(engine.data(), &VirtualDesktopBarEngine::automationReleased, this, [&] {
+        claimAutomation();
     });
 
-    QObject::connect(KWindowSystem::self(), static_cast<void (KWindowSystem::*)(WId, NET::Properties, NET::Properties2)>
-                                            (&KWindowSystem::windowChanged), this, [&](WId, NET::Properties properties, NET::Properties2) {
-        if (properties & NET::WMState) {
-            processChanges([&] { tryAddEmptyDesktop(); }, tryAddEmptyDesktopLock);
-            processChanges([&] { tryRemoveEmptyDesktops(); }, tryRemoveEmptyDesktopsLock);
-            processChanges([&] { tryRenameEmptyDesktops(); }, tryRenameEmptyDesktopsLock);
-            processChanges([&] { sendDesktopInfoList(); }, sendDesktopInfoListLock);
+    // Only one of the applets shows the rename popup
+    QObject::connect(engine.data(), &VirtualDesktopBarEngine::requestRenameCurrentDesktop, this, [&] {
+        if (engine->isAutomationOwner(this)) {
+            emit requestRenameCurrentDesktop();
         }
     });
+
+    QObject::connect(engine.data(), &VirtualDesktopBarEngine::desktopOperationFinished,
+                     this, &VirtualDesktopBar::desktopOperationFinished);
+
+    QObject::connect(engine.data(), &VirtualDesktopBarEngine::desktopOperationFailed,
+                     this, &VirtualDesktopBar::desktopOperationFailed);
+
+    QObject::connect(&engine->getWindowIndex(), &WindowIndex::screensChanged, this, [&] {
+        updateScreenIndex();
+    });
 }
 
 void VirtualDesktopBar::setUpInternalSignals() {
-    QObject::connect(this, &VirtualDesktopBar::cfg_EmptyDesktopsRenameAsChanged, this, [&] {
-        tryRenameEmptyDesktops();
+    QObject::connect(this, &VirtualDesktopBar::screenGeometryChanged, this, [&] {
+        updateScreenIndex();
     });
 
-    QObject::connect(this, &VirtualDesktopBar::cfg_DynamicDesktopsEnableChanged, this, [&] {
-        tryAddEmptyDesktop();
-        tryRemoveEmptyDesktops();
+    QObject::connect(this, &VirtualDesktopBar::labelFontChanged, this, [&] {
+        updateLabelFormatter();
     });
 
-    QObject::connect(this, &VirtualDesktopBar::cfg_MultipleScreensFilterOccupiedDesktopsChanged, this, [&] {
-        sendDesktopInfoList();
+    QObject::connect(this, &VirtualDesktopBar::cacheNameChanged, this, [&] {
+        loadCache();
     });
-}
 
-void VirtualDesktopBar::setUpGlobalKeyboardShortcuts() {
-    QString prefix = "Virtual Desktop Bar - ";
-    actionCollection = new KActionCollection(this, QStringLiteral("kwin"));
+    // Previewed rows don't match the real desktops
+    QObject::connect(&cacheSaveTimer, &QTimer::timeout, this, [&] {
+        if (previewingDesktopMove) {
+            cacheSaveTimer.start();
+            return;
+        }
+        desktopCache.save(desktopListModel.getDesktopInfoList());
+    });
+
+    QObject::connect(this, &VirtualDesktopBar::cfg_DesktopLabelsStyleChanged, this, [&] {
+        updateLabelFormatter();
+    });
 
-    actionSwitchToRecentDesktop = actionCollection->addAction(QStringLiteral("switchToRecentDesktop"));
-    actionSwitchToRecentDesktop->setText(prefix + "Switch to Recent Desktop");
-    QObject::connect(actionSwitchToRecentDesktop, &QAction::triggered, this, [&] {
-        showDesktop(mostRecentDesktopNumber);
+    QObject::connect(this, &VirtualDesktopBar::cfg_DesktopLabelsStyleCustomFormatChanged, this, [&] {
+        updateLabelFormatter();
     });
-    KGlobalAccel::setGlobalShortcut(actionSwitchToRecentDesktop, QKeySequence());
 
-    actionAddDesktop = actionCollection->addAction(QStringLiteral("addDesktop"));
-    actionAddDesktop->setText(prefix + "Add Desktop");
-    QObject::connect(actionAddDesktop, &QAction::triggered, this, [&] {
-        if (!cfg_DynamicDesktopsEnable) {
-            addDesktop();
+    QObject::connect(this, &VirtualDesktopBar::cfg_DesktopLabelsMaximumLengthChanged, this, [&] {
+        updateLabelFormatter();
+    });
+
+    QObject::connect(this, &VirtualDesktopBar::cfg_DesktopLabelsDisplayAsUppercasedChanged, this, [&] {
+        updateLabelFormatter();
+    });
+
+
+    QObject::connect(this, &VirtualDesktopBar::cfg_EmptyDesktopsRenameAsChanged, this, [&] {
+        if (engine->isAutomationOwner(this)) {
+            engine->setEmptyDesktopsRenameAs(cfg_EmptyDesktopsRenameAs);
         }
     });
-    KGlobalAccel::setGlobalShortcut(actionAddDesktop, QKeySequence());
 
-    actionRemoveLastDesktop = actionCollection->addAction(QStringLiteral("removeLastDesktop"));
-    actionRemoveLastDesktop->setText(prefix + "Remove Last Desktop");
-    QObject::connect(actionRemoveLastDesktop, &QAction::triggered, this, [&] {
-        if (!cfg_DynamicDesktopsEnable) {
-            removeDesktop(KWindowSystem::numberOfDesktops());
+    QObject::connect(this, &VirtualDesktopBar::cfg_AddingDesktopsExecuteCommandChanged, this, [&] {
+        if (engine->isAutomationOwner(this)) {
+            engine->setAddingDesktopsExecuteCommand(cfg_AddingDesktopsExecuteCommand);
         }
     });
-    KGlobalAccel::setGlobalShortcut(actionRemoveLastDesktop, QKeySequence());
 
-    actionRemoveCurrentDesktop = actionCollection->addAction(QStringLiteral("removeCurrentDesktop"));
-    actionRemoveCurrentDesktop->setText(prefix + "Remove Current Desktop");
-    QObject::connect(actionRemoveCurrentDesktop, &QAction::triggered, this, [&] {
-        if (!cfg_DynamicDesktopsEnable) {
-            removeDesktop(KWindowSystem::currentDesktop());
+    QObject::connect(this, &VirtualDesktopBar::cfg_DynamicDesktopsEnableChanged, this, [&] {
+        if (engine->isAutomationOwner(this)) {
+            engine->setDynamicDesktopsEnable(cfg_DynamicDesktopsEnable);
         }
     });
-    KGlobalAccel::setGlobalShortcut(actionRemoveCurrentDesktop, QKeySequence());
 
-    actionRenameCurrentDesktop = actionCollection->addAction(QStringLiteral("renameCurrentDesktop"));
-    actionRenameCurrentDesktop->setText(prefix + "Rename Current Desktop");
-    QObject::connect(actionRenameCurrentDesktop, &QAction::triggered, this, [&] {
-        emit requestRenameCurrentDesktop();
+    QObject::connect(this, &VirtualDesktopBar::cfg_MultipleScreensFilterOccupiedDesktopsChanged, this, [&] {
+        engine->scheduleRefresh();
     });
-    KGlobalAccel::setGlobalShortcut(actionRenameCurrentDesktop, QKeySequence());
 
-    actionMoveCurrentDesktopToLeft = actionCollection->addAction(QStringLiteral("moveCurrentDesktopToLeft"));
-    actionMoveCurrentDesktopToLeft->setText(prefix + "Move Current Desktop to Left");
-    QObject::connect(actionMoveCurrentDesktopToLeft, &QAction::triggered, this, [&] {
-        replaceDesktops(KWindowSystem::currentDesktop(),
-                        KWindowSystem::currentDesktop() - 1);
+    QObject::connect(this, &VirtualDesktopBar::cfg_WindowRulesChanged, this, [&] {
+        if (engine->isAutomationOwner(this)) {
+            engine->setWindowRules(cfg_WindowRules);
+        }
     });
-    KGlobalAccel::setGlobalShortcut(actionMoveCurrentDesktopToLeft, QKeySequence());
 
-    actionMoveCurrentDesktopToRight = actionCollection->addAction(QStringLiteral("moveCurrentDesktopToRight"));
-    actionMoveCurrentDesktopToRight->setText(prefix + "Move Current Desktop to Right");
-    QObject::connect(actionMoveCurrentDesktopToRight, &QAction::triggered, this, [&] {
-        replaceDesktops(KWindowSystem::currentDesktop(),
-                        KWindowSystem::currentDesktop() + 1);
+    QObject::connect(this, &VirtualDesktopBar::cfg_RefreshMinimumIntervalChanged, this, [&] {
+        if (engine->isAutomationOwner(this)) {
+            engine->setRefreshMinimumInterval(cfg_RefreshMinimumInterval);
+        }
     });
-    KGlobalAccel::setGlobalShortcut(actionMoveCurrentDesktopToRight, QKeySequence());
-}
 
-void VirtualDesktopBar::processChanges(std::function<void()> callback, bool& lock) {
-    if (!lock) {
-        lock = true;
-        QTimer::singleShot(1, [this, callback, &lock] {
-            lock = false;
-            callback();
-        });
-    }
-}
+    QObject::connect(this, &VirtualDesktopBar::cfg_RefreshMaximumLatencyChanged, this, [&] {
+        if (engine->isAutomationOwner(this)) {
+            engine->setRefreshMaximumLatency(cfg_RefreshMaximumLatency);
+        }
+    });
 
-DesktopInfo VirtualDesktopBar::getDesktopInfo(int number) {
-    for (auto& desktopInfo : getDesktopInfoList()) {
-        if (desktopInfo.number == number) {
-            return desktopInfo;
+    QObject::connect(this, &VirtualDesktopBar::cfg_KWinLatencyBudgetChanged, this, [&] {
+        if (engine->isAutomationOwner(this)) {
+            engine->setKWinLatencyBudget(cfg_KWinLatencyBudget);
         }
-    }
-    return DesktopInfo();
-}
+    });
 
-DesktopInfo VirtualDesktopBar::getDesktopInfo(QString id) {
-    for (auto& desktopInfo : getDesktopInfoList()) {
-        if (desktopInfo.id == id) {
-            return desktopInfo;
+    QObject::connect(this, &VirtualDesktopBar::cfg_HooksDesktopAddedCommandChanged, this, [&] {
+        if (engine->isAutomationOwner(this)) {
+            engine->setHookCommand(HookRunner::DesktopAdded, cfg_HooksDesktopAddedCommand);
         }
-    }
-    return DesktopInfo();
-}
+    });
 
-QList<DesktopInfo> VirtualDesktopBar::getDesktopInfoList(bool extraInfo) {
-    QList<DesktopInfo> desktopInfoList;
+    QObject::connect(this, &VirtualDesktopBar::cfg_HooksDesktopRemovedCommandChanged, this, [&] {
+        if (engine->isAutomationOwner(this)) {
+            engine->setHookCommand(HookRunner::DesktopRemoved, cfg_HooksDesktopRemovedCommand);
+        }
+    });
 
-    // Getting info about desktops through the KWin's D-Bus service here
-    auto reply = dbusInterface.call("Get", dbusInterfaceName, "desktops");
+    QObject::connect(this, &VirtualDesktopBar::cfg_HooksDesktopSwitchedCommandChanged, this, [&] {
+        if (engine->isAutomationOwner(this)) {
+            engine->setHookCommand(HookRunner::DesktopSwitched, cfg_HooksDesktopSwitchedCommand);
+        }
+    });
 
-    if (reply.type() == QDBusMessage::ErrorMessage) {
-        for (int i = 1; i <= KWindowSystem::numberOfDesktops(); i++) {
-            DesktopInfo desktopInfo;
-            desktopInfo.id = i;
-            desktopInfo.number = i;
-            desktopInfo.name = KWindowSystem::desktopName(i);
+    QObject::connect(this, &VirtualDesktopBar::cfg_HooksDesktopBecameEmptyCommandChanged, this, [&] {
+        if (engine->isAutomationOwner(this)) {
+            engine->setHookCommand(HookRunner::DesktopBecameEmpty, cfg_HooksDesktopBecameEmptyCommand);
+        }
+    });
 
-            desktopInfoList << desktopInfo;
+    QObject::connect(this, &VirtualDesktopBar::cfg_HooksDesktopBecameOccupiedCommandChanged, this, [&] {
+        if (engine->isAutomationOwner(this)) {
+            engine->setHookCommand(HookRunner::DesktopBecameOccupied, cfg_HooksDesktopBecameOccupiedCommand);
         }
-    } else {
-        // Extracting data from the D-Bus reply message here
-        // More details at https://stackoverflow.com/a/20206377
-        auto something = reply.arguments().at(0).value<QDBusVariant>();
-        auto somethingSomething = something.variant().value<QDBusArgument>();
-        somethingSomething >> desktopInfoList;
+    });
+}
+
+void VirtualDesktopBar::claimAutomation() {
+    if (engine->claimAutomation(this)) {
+        engine->setEmptyDesktopsRenameAs(cfg_EmptyDesktopsRenameAs);
+        engine->setAddingDesktopsExecuteCommand(cfg_AddingDesktopsExecuteCommand);
+        engine->setDynamicDesktopsEnable(cfg_DynamicDesktopsEnable);
+        engine->setWindowRules(cfg_WindowRules);
+        engine->setRefreshMinimumInterval(cfg_RefreshMinimumInterval);
+        engine->setRefreshMaximumLatency(cfg_RefreshMaximumLatency);
+        engine->setKWinLatencyBudget(cfg_KWinLatencyBudget);
+        engine->setHookCommand(HookRunner::DesktopAdded, cfg_HooksDesktopAddedCommand);
+        engine->setHookCommand(HookRunner::DesktopRemoved, cfg_HooksDesktopRemovedCommand);
+        engine->setHookCommand(HookRunner::DesktopSwitched, cfg_HooksDesktopSwitchedCommand);
+        engine->setHookCommand(HookRunner::DesktopBecameEmpty, cfg_HooksDesktopBecameEmptyCommand);
+        engine->setHookCommand(HookRunner::DesktopBecameOccupied, cfg_HooksDesktopBecameOccupiedCommand);
     }
+}
+
+QList<DesktopInfo> VirtualDesktopBar::getDesktopInfoList(bool extraInfo) {
+    QList<DesktopInfo> desktopInfoList = engine->getDesktopManager().getDesktopInfoList();
+    int currentDesktopNumber = engine->getCurrentDesktopNumber();
 
     for (auto& desktopInfo : desktopInfoList) {
-        desktopInfo.isCurrent = desktopInfo.number == KWindowSystem::currentDesktop();
+        desktopInfo.isCurrent = desktopInfo.number == currentDesktopNumber;
 
         if (!extraInfo) {
             continue;
         }
 
+        // Windows aren't known before the engine has finished its startup,
+        // and until KWin tells the desktops' ids, they go by their numbers
+        if (!engine->isStarted()) {
+            auto cachedDesktopInfo = engine->getDesktopManager().isUsingFallback() ?
+                                     desktopCache.getDesktopInfo(desktopInfo.number) :
+                                     desktopCache.getDesktopInfo(desktopInfo.id);
+            if (cachedDesktopInfo) {
+                desktopInfo.isEmpty = cachedDesktopInfo->isEmpty;
+                desktopInfo.isUrgent = cachedDesktopInfo->isUrgent;
+            }
+            continue;
+        }
+
         auto windowInfoList = getWindowInfoList(desktopInfo.number);
 
         desktopInfo.isEmpty = windowInfoList.isEmpty();
 
-        for (int i = 0; i < windowInfoList.length(); i++) {
-            auto& windowInfo = windowInfoList[i];
-
-            if (!desktopInfo.isUrgent) {
-                desktopInfo.isUrgent = windowInfo.hasState(NET::DemandsAttention);
-            }
-
-            QString windowName = windowInfo.name();
-            int separatorPosition = qMax(windowName.lastIndexOf(" - "),
-                                         qMax(windowName.lastIndexOf(" – "),
-                                              windowName.lastIndexOf(" — ")));
-            if (separatorPosition >= 0) {
-                separatorPosition += 3;
-                int length = windowName.length() - separatorPosition;
-                QStringRef substringRef(&windowName, separatorPosition, length);
-                windowName = substringRef.toString().trimmed();
-            }
-
-            if (i == 0) {
-                desktopInfo.activeWindowName = windowName;
+        for (auto& windowInfo : windowInfoList) {
+            if (windowInfo.hasState(NET::DemandsAttention)) {
+                desktopInfo.isUrgent = true;
+                break;
             }
+        }
 
-            desktopInfo.windowNameList << windowName;
+        if (labelFormatter.isActiveWindowNameNeeded() && !windowInfoList.isEmpty()) {
+            desktopInfo.activeWindowName = windowInfoList.first().shortName;
         }
     }
 
+    if (extraInfo) {
+        updateLabels(desktopInfoList);
+    }
+
     return desktopInfoList;
 }
 
-QList<KWindowInfo> VirtualDesktopBar::getWindowInfoList(int desktopNumber, bool ignoreScreens) {
-    QList<KWindowInfo> windowInfoList;
-
-    auto screenRect = QGuiApplication::screens().at(0)->geometry();
+void VirtualDesktopBar::updateLabels(QList<DesktopInfo>& desktopInfoList) {
+    for (auto& desktopInfo : desktopInfoList) {
+        desktopInfo.label = labelFormatter.format(desktopInfo);
+        desktopInfo.labelWidth = labelFormatter.getWidth(desktopInfo.label);
+    }
+}
 
-    QList<WId> windowIds = KWindowSystem::stackingOrder();
-    for (int i = windowIds.length() - 1; i >= 0; i--) {
-        KWindowInfo windowInfo(windowIds[i], NET::WMState |
-                                             NET::WMDesktop |
-                                             NET::WMGeometry |
-                                             NET::WMWindowType |
-                                             NET::WMName);
+void VirtualDesktopBar::updateLabelFormatter() {
+    labelFormatter.setStyle(cfg_DesktopLabelsStyle);
+    labelFormatter.setCustomFormat(cfg_DesktopLabelsStyleCustomFormat);
+    labelFormatter.setMaximumLength(cfg_DesktopLabelsMaximumLength);
+    labelFormatter.setUppercased(cfg_DesktopLabelsDisplayAsUppercased);
+    labelFormatter.setFont(labelFont);
 
-        // Skipping windows not present on the current desktops
-        if (windowInfo.desktop() != desktopNumber &&
-            windowInfo.desktop() != -1) {
-            continue;
-        }
+    engine->setWindowNamesShown(this, labelFormatter.isActiveWindowNameNeeded());
+    engine->scheduleRefresh();
+}
 
-        // Skipping some flagged windows
-        if (windowInfo.hasState(NET::SkipPager) ||
-            windowInfo.hasState(NET::SkipTaskbar)) {
-            continue;
-        }
+QList<WindowInfo> VirtualDesktopBar::getWindowInfoList(int desktopNumber, bool ignoreScreens) {
+    QList<WindowInfo> windowInfoList = engine->getWindowIndex().getWindowInfoList(desktopNumber);
 
-        auto windowType = windowInfo.windowType(NET::AllTypesMask);
-        if (windowType != -1 &&
-            ((windowType == NET::Dock) ||
-             (windowType == NET::Desktop))) {
-            continue;
-        }
-
-        // Skipping windows not present on the current screen
-        if (!ignoreScreens && cfg_MultipleScreensFilterOccupiedDesktops) {
-            auto windowRect = windowInfo.geometry();
-            auto intersectionRect = screenRect.intersected(windowRect);
-            if (intersectionRect.width() < windowRect.width() / 2 ||
-                intersectionRect.height() < windowRect.height() / 2) {
-                continue;
+    // Skipping windows not present on the applet's screen
+    if (!ignoreScreens && cfg_MultipleScreensFilterOccupiedDesktops) {
+        for (int i = windowInfoList.length() - 1; i >= 0; i--) {
+            if (!windowInfoList[i].isOnScreen(screenIndex)) {
+                windowInfoList.removeAt(i);
             }
         }
-
-        windowInfoList << windowInfo;
     }
 
     return windowInfoList;
 }
 
-QList<int> VirtualDesktopBar::getEmptyDesktopNumberList(bool noCheating) {
-    QList<int> emptyDesktopNumberList;
-
-    for (int i = 1; i <= KWindowSystem::numberOfDesktops(); i++) {
-        auto windowInfoList = getWindowInfoList(i, true);
-
-        if (noCheating) {
-            if (windowInfoList.empty()) {
-                emptyDesktopNumberList << i;
-            }
-            continue;
-        }
+void VirtualDesktopBar::sendDesktopInfoList() {
+    QElapsedTimer timer;
+    timer.start();
 
-        bool isConsideredEmpty = true;
-        for (auto& windowInfo : windowInfoList) {
-            if (windowInfo.desktop() == i) {
-                isConsideredEmpty = false;
-                break;
-            }
-        }
+    desktopListModel.update(getDesktopInfoList(true));
 
-        if (isConsideredEmpty) {
-            emptyDesktopNumberList << i;
-        }
+    // Only the live state is worth remembering
+    if (engine->isStarted() && !cacheSaveTimer.isActive()) {
+        cacheSaveTimer.start();
     }
 
-    return emptyDesktopNumberList;
-}
-
-void VirtualDesktopBar::sendDesktopInfoList() {
-    QVariantList desktopInfoList;
-    for (auto& desktopInfo : getDesktopInfoList(true)) {
-        desktopInfoList << desktopInfo.toQVariantMap();
+    qint64 nanoseconds = timer.nsecsElapsed();
+    Statistics::get().record(Statistics::RefreshDuration, nanoseconds);
+    if (cfg_RefreshBudget > 0 && nanoseconds > qint64(cfg_RefreshBudget) * 1000000) {
+        Statistics::get().increment(Statistics::SlowRefreshes);
+        reportSlowRefresh(nanoseconds);
     }
-    emit desktopInfoListSent(desktopInfoList);
 }
 
-void VirtualDesktopBar::tryAddEmptyDesktop() {
-    if (cfg_DynamicDesktopsEnable) {
-        auto emptyDesktopNumberList = getEmptyDesktopNumberList(false);
-        if (emptyDesktopNumberList.empty()) {
-            addDesktop();
-        }
+void VirtualDesktopBar::reportSlowRefresh(qint64 nanoseconds) {
+    if (slowRefreshLogTimer.isValid() && slowRefreshLogTimer.elapsed() < slowRefreshLogInterval) {
+        suppressedSlowRefreshCount++;
+        return;
     }
+
+    qWarning("Refresh of %d desktops took %lld us, over the budget of %d ms (%d more not logged)",
+             desktopListModel.getCount(), nanoseconds / 1000, cfg_RefreshBudget,
+             suppressedSlowRefreshCount);
+
+    suppressedSlowRefreshCount = 0;
+    slowRefreshLogTimer.start();
 }
 
-void VirtualDesktopBar::tryRemoveEmptyDesktops() {
-    if (cfg_DynamicDesktopsEnable) {
-        auto emptyDesktopNumberList = getEmptyDesktopNumberList(false);
-        for (int i = 1; i < emptyDesktopNumberList.length(); i++) {
-            int desktopNumber = emptyDesktopNumberList[i];
-            removeDesktop(desktopNumber);
-        }
+void VirtualDesktopBar::loadCache() {
+    desktopCache.open(cacheName);
+
+    // Refreshes coming before the applet sets the name are newer anyway
+    if (desktopListModel.getCount() > 0 || desktopCache.isEmpty()) {
+        return;
     }
-}
 
-void VirtualDesktopBar::tryRenameEmptyDesktops() {
-    if (!cfg_EmptyDesktopsRenameAs.isEmpty()) {
-        auto emptyDesktopNumberList = getEmptyDesktopNumberList();
-        for (int desktopNumber : emptyDesktopNumberList) {
-            renameDesktop(desktopNumber, cfg_EmptyDesktopsRenameAs);
-        }
+    auto desktopInfoList = desktopCache.getDesktopInfoList();
+    for (auto& desktopInfo : desktopInfoList) {
+        desktopInfo.isCurrent = desktopInfo.number == engine->getCurrentDesktopNumber();
     }
+    desktopListModel.update(desktopInfoList);
 }
 
-void VirtualDesktopBar::updateLocalDesktopNumbers() {
-    int n = KWindowSystem::currentDesktop();
-    if (currentDesktopNumber != n) {
-        mostRecentDesktopNumber = currentDesktopNumber;
+void VirtualDesktopBar::updateScreenIndex() {
+    int n = engine->getWindowIndex().getScreenIndex(screenGeometry);
+    if (screenIndex != n) {
+        screenIndex = n;
+        if (cfg_MultipleScreensFilterOccupiedDesktops) {
+            engine->scheduleRefresh();
+        }
     }
-    currentDesktopNumber = n;
 }
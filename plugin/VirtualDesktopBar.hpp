@@ -1,39 +1,84 @@
 #pragma once
 
-#include <QAction>
-#include <QDBusInterface>
+#include <QElapsedTimer>
+#include <QFont>
 #include <QList>
 #include <QObject>
+#include <QRect>
+#include <QSharedPointer>
 #include <QString>
-#include <QVariantList>
-
-#include <netwm.h>
-
-#include <KActionCollection>
-#include <KWindowSystem>
+#include <QStringList>
+#include <QTimer>
+#include <QVariantMap>
 
+#include "DesktopCache.hpp"
 #include "DesktopInfo.hpp"
+#include "DesktopLabelFormatter.hpp"
+#include "DesktopListModel.hpp"
+#include "VirtualDesktopBarEngine.hpp"
+#include "WindowInfo.hpp"
 
 class VirtualDesktopBar : public QObject {
     Q_OBJECT
 
 public:
     VirtualDesktopBar(QObject* parent = nullptr);
+    ~VirtualDesktopBar();
+
+    DesktopListModel* getDesktopListModel();
 
     Q_INVOKABLE void requestDesktopInfoList();
 
+    // Called once the desktop buttons are set, with the window they go to,
+    // so that the startup ends when its next frame is on screen
+    Q_INVOKABLE void reportDesktopButtonsPopulated(QObject* window);
+
+    Q_INVOKABLE QVariantMap getRefreshStatistics();
+    Q_INVOKABLE QVariantMap getStatistics();
+
+    // Short names of the desktop's windows, from the top of the stack,
+    // asked for only when needed instead of being part of every refresh
+    Q_INVOKABLE QStringList getWindowNameList(int number);
+
     Q_INVOKABLE void showDesktop(int number);
+    Q_INVOKABLE void switchDesktopBy(int steps, bool wrap);
     Q_INVOKABLE void addDesktop(unsigned position = 0);
     Q_INVOKABLE void removeDesktop(int number);
+    Q_INVOKABLE void removeDesktops(QList<int> numbers);
     Q_INVOKABLE void renameDesktop(int number, QString name);
-    Q_INVOKABLE void replaceDesktops(int number1, int number2);
+    Q_INVOKABLE void previewMoveDesktop(int fromNumber, int toNumber);
+    Q_INVOKABLE void moveDesktop(int fromNumber, int toNumber);
+
+    // Ends a previewed move without moving anything, e.g. when the drag is canceled
+    Q_INVOKABLE void cancelMoveDesktop();
+
+    Q_PROPERTY(DesktopListModel* desktopListModel
+               READ getDesktopListModel
+               CONSTANT);
+
+    // Geometry of the screen the applet is on, used to filter occupied desktops
+    Q_PROPERTY(QRect screenGeometry
+               MEMBER screenGeometry
+               NOTIFY screenGeometryChanged);
+
+    // Font of the labels, used to measure them
+    Q_PROPERTY(QFont labelFont
+               MEMBER labelFont
+               NOTIFY labelFontChanged);
+
+    // Name of the file the desktops are cached in, unique to the applet,
+    // whose desktops are shown as soon as it's set
+    Q_PROPERTY(QString cacheName
+               MEMBER cacheName
+               NOTIFY cacheNameChanged);
 
     Q_PROPERTY(QString cfg_EmptyDesktopsRenameAs
                MEMBER cfg_EmptyDesktopsRenameAs
                NOTIFY cfg_EmptyDesktopsRenameAsChanged);
 
     Q_PROPERTY(QString cfg_AddingDesktopsExecuteCommand
-               MEMBER cfg_AddingDesktopsExecuteCommand);
+               MEMBER cfg_AddingDesktopsExecuteCommand
+               NOTIFY cfg_AddingDesktopsExecuteCommandChanged);
 
     Q_PROPERTY(bool cfg_DynamicDesktopsEnable
                MEMBER cfg_DynamicDesktopsEnable
@@ -43,61 +88,159 @@ public:
                MEMBER cfg_MultipleScreensFilterOccupiedDesktops
                NOTIFY cfg_MultipleScreensFilterOccupiedDesktopsChanged);
 
+    Q_PROPERTY(int cfg_DesktopLabelsStyle
+               MEMBER cfg_DesktopLabelsStyle
+               NOTIFY cfg_DesktopLabelsStyleChanged);
+
+    Q_PROPERTY(QString cfg_DesktopLabelsStyleCustomFormat
+               MEMBER cfg_DesktopLabelsStyleCustomFormat
+               NOTIFY cfg_DesktopLabelsStyleCustomFormatChanged);
+
+    Q_PROPERTY(int cfg_DesktopLabelsMaximumLength
+               MEMBER cfg_DesktopLabelsMaximumLength
+               NOTIFY cfg_DesktopLabelsMaximumLengthChanged);
+
+    Q_PROPERTY(bool cfg_DesktopLabelsDisplayAsUppercased
+               MEMBER cfg_DesktopLabelsDisplayAsUppercased
+               NOTIFY cfg_DesktopLabelsDisplayAsUppercasedChanged);
+
+    Q_PROPERTY(QStringList cfg_WindowRules
+               MEMBER cfg_WindowRules
+               NOTIFY cfg_WindowRulesChanged);
+
+    Q_PROPERTY(int cfg_RefreshMinimumInterval
+               MEMBER cfg_RefreshMinimumInterval
+               NOTIFY cfg_RefreshMinimumIntervalChanged);
+
+    Q_PROPERTY(int cfg_RefreshMaximumLatency
+               MEMBER cfg_RefreshMaximumLatency
+               NOTIFY cfg_RefreshMaximumLatencyChanged);
+
+    Q_PROPERTY(int cfg_RefreshBudget
+               MEMBER cfg_RefreshBudget
+               NOTIFY cfg_RefreshBudgetChanged);
+
+    Q_PROPERTY(int cfg_StartupBudget
+               MEMBER cfg_StartupBudget
+               NOTIFY cfg_StartupBudgetChanged);
+
+    Q_PROPERTY(int cfg_KWinLatencyBudget
+               MEMBER cfg_KWinLatencyBudget
+               NOTIFY cfg_KWinLatencyBudgetChanged);
+
+    Q_PROPERTY(QString cfg_HooksDesktopAddedCommand
+               MEMBER cfg_HooksDesktopAddedCommand
+               NOTIFY cfg_HooksDesktopAddedCommandChanged);
+
+    Q_PROPERTY(QString cfg_HooksDesktopRemovedCommand
+               MEMBER cfg_HooksDesktopRemovedCommand
+               NOTIFY cfg_HooksDesktopRemovedCommandChanged);
+
+    Q_PROPERTY(QString cfg_HooksDesktopSwitchedCommand
+               MEMBER cfg_HooksDesktopSwitchedCommand
+               NOTIFY cfg_HooksDesktopSwitchedCommandChanged);
+
+    Q_PROPERTY(QString cfg_HooksDesktopBecameEmptyCommand
+               MEMBER cfg_HooksDesktopBecameEmptyCommand
+               NOTIFY cfg_HooksDesktopBecameEmptyCommandChanged);
+
+    Q_PROPERTY(QString cfg_HooksDesktopBecameOccupiedCommand
+               MEMBER cfg_HooksDesktopBecameOccupiedCommand
+               NOTIFY cfg_HooksDesktopBecameOccupiedCommandChanged);
+
 signals:
-    void desktopInfoListSent(QVariantList desktopInfoList);
     void requestRenameCurrentDesktop();
+    void currentDesktopChanged(int oldNumber, int newNumber);
+
+    void desktopOperationFinished(QString operation, int number);
+    void desktopOperationFailed(QString operation, int number, QString errorMessage);
+
+    void screenGeometryChanged();
+    void labelFontChanged();
+    void cacheNameChanged();
 
     void cfg_EmptyDesktopsRenameAsChanged();
     void cfg_AddingDesktopsExecuteCommandChanged();
     void cfg_DynamicDesktopsEnableChanged();
     void cfg_MultipleScreensFilterOccupiedDesktopsChanged();
+    void cfg_DesktopLabelsStyleChanged();
+    void cfg_DesktopLabelsStyleCustomFormatChanged();
+    void cfg_DesktopLabelsMaximumLengthChanged();
+    void cfg_DesktopLabelsDisplayAsUppercasedChanged();
+    void cfg_WindowRulesChanged();
+    void cfg_RefreshMinimumIntervalChanged();
+    void cfg_RefreshMaximumLatencyChanged();
+    void cfg_RefreshBudgetChanged();
+    void cfg_StartupBudgetChanged();
+    void cfg_KWinLatencyBudgetChanged();
+    void cfg_HooksDesktopAddedCommandChanged();
+    void cfg_HooksDesktopRemovedCommandChanged();
+    void cfg_HooksDesktopSwitchedCommandChanged();
+    void cfg_HooksDesktopBecameEmptyCommandChanged();
+    void cfg_HooksDesktopBecameOccupiedCommandChanged();
+
+private slots:
+    void reportFirstPaint();
 
 private:
-    NETRootInfo netRootInfo;
-    QDBusInterface dbusInterface;
-    QString dbusInterfaceName;
+    // Started before the engine is set up, which the first applet waits for
+    QElapsedTimer firstPaintTimer;
+
+    QSharedPointer<VirtualDesktopBarEngine> engine;
+    DesktopListModel desktopListModel;
 
     void setUpSignals();
-    void setUpKWinSignals();
+    void setUpEngineSignals();
     void setUpInternalSignals();
-    void setUpGlobalKeyboardShortcuts();
 
-    DesktopInfo getDesktopInfo(int number);
-    DesktopInfo getDesktopInfo(QString id);
+    bool previewingDesktopMove;
+
     QList<DesktopInfo> getDesktopInfoList(bool extraInfo = false);
-    QList<KWindowInfo> getWindowInfoList(int desktopNumber, bool ignoreScreens = false);
-    QList<int> getEmptyDesktopNumberList(bool noCheating = true);
+    QList<WindowInfo> getWindowInfoList(int desktopNumber, bool ignoreScreens = false);
+
+    QFont labelFont;
+    DesktopLabelFormatter labelFormatter;
+    void updateLabelFormatter();
+    void updateLabels(QList<DesktopInfo>& desktopInfoList);
+
+    // Until windows are known, desktops look as they did last time
+    QString cacheName;
+    DesktopCache desktopCache;
+    QTimer cacheSaveTimer;
+    void loadCache();
+
+    QRect screenGeometry;
+    int screenIndex;
+    void updateScreenIndex();
 
     QString cfg_EmptyDesktopsRenameAs;
     QString cfg_AddingDesktopsExecuteCommand;
     bool cfg_DynamicDesktopsEnable;
     bool cfg_MultipleScreensFilterOccupiedDesktops;
     bool cfg_MultipleScreensEnableSeparateDesktops;
+    int cfg_DesktopLabelsStyle;
+    QString cfg_DesktopLabelsStyleCustomFormat;
+    int cfg_DesktopLabelsMaximumLength;
+    bool cfg_DesktopLabelsDisplayAsUppercased;
+    QStringList cfg_WindowRules;
+    int cfg_RefreshMinimumInterval;
+    int cfg_RefreshMaximumLatency;
+    int cfg_RefreshBudget;
+    int cfg_StartupBudget;
+    int cfg_KWinLatencyBudget;
+    QString cfg_HooksDesktopAddedCommand;
+    QString cfg_HooksDesktopRemovedCommand;
+    QString cfg_HooksDesktopSwitchedCommand;
+    QString cfg_HooksDesktopBecameEmptyCommand;
+    QString cfg_HooksDesktopBecameOccupiedCommand;
+
+    // Settings of the automation come from one applet only
+    void claimAutomation();
 
     void sendDesktopInfoList();
-    bool sendDesktopInfoListLock;
-
-    void tryAddEmptyDesktop();
-    bool tryAddEmptyDesktopLock;
-
-    void tryRemoveEmptyDesktops();
-    bool tryRemoveEmptyDesktopsLock;
-
-    void tryRenameEmptyDesktops();
-    bool tryRenameEmptyDesktopsLock;
-
-    void processChanges(std::function<void()> callback, bool& lock);
-
-    int currentDesktopNumber;
-    int mostRecentDesktopNumber;
-    void updateLocalDesktopNumbers();
 
-    KActionCollection* actionCollection;
-    QAction* actionSwitchToRecentDesktop;
-    QAction* actionAddDesktop;
-    QAction* actionRemoveLastDesktop;
-    QAction* actionRemoveCurrentDesktop;
-    QAction* actionRenameCurrentDesktop;
-    QAction* actionMoveCurrentDesktopToLeft;
-    QAction* actionMoveCurrentDesktopToRight;
+    // Refreshes over the budget are logged at most once in a while
+    QElapsedTimer slowRefreshLogTimer;
+    int suppressedSlowRefreshCount;
+    void reportSlowRefresh(qint64 nanoseconds);
 };
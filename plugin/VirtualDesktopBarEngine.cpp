@@ -0,0 +1,945 @@
+#include "VirtualDesktopBarEngine.hpp"
+
+#include <QPair>
+#include <QVector>
+#include <QWeakPointer>
+
+#include <KGlobalAccel>
+
+#include "SimulatedBackend.hpp"
+#include "TraceRecorder.hpp"
+#include "TraceReplayer.hpp"
+
+// How long the changes made by the applet itself may take to show up
+static const int desktopTransactionTimeout = 500;
+
+// Input is applied at most once per frame
+static const int inputInterval = 16;
+
+// How long the window scan may wait for an applet to show up
+static const int startupTimeout = 1000;
+
+// Shortcuts are registered after the refresh following the window scan
+static const int shortcutRegistrationDelay = 500;
+
+// Same as the most desktops KWin allows
+static const int numberOfDesktopActions = 20;
+
+QSharedPointer<VirtualDesktopBarEngine> VirtualDesktopBarEngine::getInstance() {
+    static QWeakPointer<VirtualDesktopBarEngine> instance;
+
+    auto engine = instance.toStrongRef();
+    if (!engine) {
+        QElapsedTimer timer;
+        timer.start();
+
+        // The last applet may go away in the middle of the engine's own signal,
+        // so the engine is deleted later, but the next one may be set up before
+        // that, e.g. when the panel is reloaded, so it lets go of the session now
+        engine = QSharedPointer<VirtualDesktopBarEngine>(new VirtualDesktopBarEngine(),
+                                                         [](VirtualDesktopBarEngine* oldEngine) {
+            oldEngine->shutDown();
+            oldEngine->deleteLater();
+        });
+        instance = engine;
+
+        Statistics::get().recordPhase(Statistics::EngineSetUp, timer.nsecsElapsed());
+    }
+
+    return engine;
+}
+
+VirtualDesktopBarEngine::VirtualDesktopBarEngine() : QObject(nullptr),
+        backend(WindowSystemBackend::create(this)),
+        desktopManager(backend),
+        windowIndex(backend),
+        statisticsExporter(nullptr),
+        stateExporter(nullptr),
+        started(false),
+        desktopTransactionPending(false),
+        shownDesktopNumber(backend->currentDesktop()),
+        pendingSwitchNumber(0),
+        pendingSwitchSteps(0),
+        pendingSwitchWrap(false),
+        pendingMoveSteps(0),
+        pendingWindowDesktopNumber(0),
+        automationOwner(nullptr),
+        dynamicDesktopsEnable(false),
+        addingDesktopCount(0),
+        knownDesktopsUsingFallback(desktopManager.isUsingFallback()),
+        numberOfDesktops(desktopManager.getNumberOfDesktops()),
+        currentDesktopNumber(backend->currentDesktop()),
+        mostRecentDesktopNumber(currentDesktopNumber) {
+
+    desktopTransactionTimer.setSingleShot(true);
+    desktopTransactionTimer.setInterval(desktopTransactionTimeout);
+
+    desktopSwitchTimer.setSingleShot(true);
+    desktopSwitchTimer.setInterval(desktopTransactionTimeout);
+
+    inputTimer.setSingleShot(true);
+    inputTimer.setInterval(inputInterval);
+
+    startupTimer.setSingleShot(true);
+    startupTimer.setInterval(startupTimeout);
+
+    setUpSignals();
+    updateKnownDesktops();
+    startupTimer.start();
+
+    setUpTracing();
+
+    // Counters are kept anyway, only their export needs the real session bus
+    if (backend->isLiveSession()) {
+        statisticsExporter = new StatisticsExporter(this);
+        stateExporter = new StateExporter(this);
+    }
+}
+
+void VirtualDesktopBarEngine::shutDown() {
+    // Their D-Bus paths are free for the next engine to take
+    delete statisticsExporter;
+    statisticsExporter = nullptr;
+    delete stateExporter;
+    stateExporter = nullptr;
+
+    // Nothing reaches the automation anymore, so no more commands go to KWin
+    backend->disconnect();
+    desktopManager.disconnect();
+    windowIndex.disconnect();
+    changeScheduler.hold();
+
+    startupTimer.stop();
+    desktopTransactionTimer.stop();
+    desktopSwitchTimer.stop();
+    inputTimer.stop();
+}
+
+const WindowSystemBackend& VirtualDesktopBarEngine::getBackend() const {
+    return *backend;
+}
+
+const DesktopManager& VirtualDesktopBarEngine::getDesktopManager() const {
+    return desktopManager;
+}
+
+const WindowIndex& VirtualDesktopBarEngine::getWindowIndex() const {
+    return windowIndex;
+}
+
+const ChangeScheduler& VirtualDesktopBarEngine::getChangeScheduler() const {
+    return changeScheduler;
+}
+
+SimulatedBackend* VirtualDesktopBarEngine::getSimulatedBackend() const {
+    return qobject_cast<SimulatedBackend*>(backend);
+}
+
+void VirtualDesktopBarEngine::finishStartup() {
+    if (started || windowScanTimer.isValid()) {
+        return;
+    }
+
+    startupTimer.stop();
+    windowScanTimer.start();
+    windowIndex.rebuild();
+}
+
+bool VirtualDesktopBarEngine::isStarted() const {
+    return started;
+}
+
+int VirtualDesktopBarEngine::getCurrentDesktopNumber() const {
+    return shownDesktopNumber;
+}
+
+void VirtualDesktopBarEngine::showDesktop(int number) {
+    if (number < 1 || number > backend->numberOfDesktops()) {
+        return;
+    }
+
+    updateShownDesktopNumber(number);
+    desktopSwitchTimer.start();
+
+    backend->setCurrentDesktop(number);
+}
+
+void VirtualDesktopBarEngine::addDesktop() {
+    backend->setNumberOfDesktops(backend->numberOfDesktops() + 1);
+
+    if (!addingDesktopsExecuteCommand.isEmpty()) {
+        addingDesktopCount++;
+        addingDesktopTimer.start();
+    }
+}
+
+void VirtualDesktopBarEngine::removeDesktops(const QList<int>& numbers) {
+    if (numbers.isEmpty()) {
+        return;
+    }
+
+    // KWin's own signals are collected into one refresh after the last removal
+    changeScheduler.hold();
+
+    desktopManager.removeDesktops(numbers, [&](QList<int> failedNumbers) {
+        if (!failedNumbers.isEmpty()) {
+            removeDesktopsManually(failedNumbers);
+        }
+        changeScheduler.release();
+    });
+}
+
+void VirtualDesktopBarEngine::renameDesktop(int number, const QString& name) {
+    desktopManager.renameDesktop(number, name);
+}
+
+void VirtualDesktopBarEngine::moveDesktop(int fromNumber, int toNumber) {
+    int n = backend->numberOfDesktops();
+    if (fromNumber < 1 || fromNumber > n || toNumber < 1 || toNumber > n || fromNumber == toNumber) {
+        return;
+    }
+
+    QList<int> desktopNumberList;
+    for (int i = 1; i <= n; i++) {
+        desktopNumberList << i;
+    }
+    desktopNumberList.move(fromNumber - 1, toNumber - 1);
+
+    applyDesktopPermutation(desktopNumberList);
+}
+
+void VirtualDesktopBarEngine::switchToDesktop(int number) {
+    pendingSwitchNumber = number;
+    pendingSwitchSteps = 0;
+    scheduleInput();
+}
+
+void VirtualDesktopBarEngine::switchDesktopBy(int steps, bool wrap) {
+    pendingSwitchSteps += steps;
+    pendingSwitchWrap = wrap;
+    scheduleInput();
+}
+
+void VirtualDesktopBarEngine::moveCurrentDesktopBy(int steps) {
+    pendingMoveSteps += steps;
+    scheduleInput();
+}
+
+void VirtualDesktopBarEngine::moveActiveWindowToDesktop(int number) {
+    pendingWindowDesktopNumber = number;
+    scheduleInput();
+}
+
+void VirtualDesktopBarEngine::scheduleRefresh() {
+    processChanges(ChangeScheduler::SendDesktopInfoList,
+                   Statistics::TriggersFromApplet);
+}
+
+void VirtualDesktopBarEngine::holdChanges() {
+    changeScheduler.hold();
+}
+
+void VirtualDesktopBarEngine::releaseChanges() {
+    changeScheduler.release();
+}
+
+void VirtualDesktopBarEngine::setWindowNamesShown(const QObject* client, bool shown) {
+    if (shown) {
+        windowNameClientSet.insert(client);
+    } else {
+        windowNameClientSet.remove(client);
+    }
+}
+
+bool VirtualDesktopBarEngine::claimAutomation(const QObject* client) {
+    if (!automationOwner) {
+        automationOwner = client;
+    }
+    return automationOwner == client;
+}
+
+void VirtualDesktopBarEngine::releaseAutomation(const QObject* client) {
+    if (automationOwner == client) {
+        automationOwner = nullptr;
+        emit automationReleased();
+    }
+}
+
+bool VirtualDesktopBarEngine::isAutomationOwner(const QObject* client) const {
+    return automationOwner == client;
+}
+
+void VirtualDesktopBarEngine::setEmptyDesktopsRenameAs(const QString& name) {
+    if (emptyDesktopsRenameAs != name) {
+        emptyDesktopsRenameAs = name;
+        processChanges(ChangeScheduler::RenameEmptyDesktops,
+                       Statistics::TriggersFromConfiguration);
+    }
+}
+
+void VirtualDesktopBarEngine::setAddingDesktopsExecuteCommand(const QString& command) {
+    addingDesktopsExecuteCommand = command;
+}
+
+void VirtualDesktopBarEngine::setHookCommand(HookRunner::Hook hook, const QString& command) {
+    hookRunner.setCommand(hook, command);
+}
+
+void VirtualDesktopBarEngine::setWindowRules(const QStringList& ruleStringList) {
+    windowRules.compile(ruleStringList);
+}
+
+void VirtualDesktopBarEngine::setDynamicDesktopsEnable(bool enable) {
+    if (dynamicDesktopsEnable != enable) {
+        dynamicDesktopsEnable = enable;
+        processChanges(ChangeScheduler::AddEmptyDesktop |
+                       ChangeScheduler::RemoveEmptyDesktops,
+                       Statistics::TriggersFromConfiguration);
+    }
+}
+
+void VirtualDesktopBarEngine::setRefreshMinimumInterval(int milliseconds) {
+    changeScheduler.setMinimumInterval(milliseconds);
+}
+
+void VirtualDesktopBarEngine::setRefreshMaximumLatency(int milliseconds) {
+    changeScheduler.setMaximumLatency(milliseconds);
+}
+
+void VirtualDesktopBarEngine::setKWinLatencyBudget(int milliseconds) {
+    desktopManager.setLatencyBudget(milliseconds);
+}
+
+void VirtualDesktopBarEngine::scheduleInput() {
+    // Not restarted, so that a steady stream still gets applied every frame
+    if (!inputTimer.isActive()) {
+        inputTimer.start();
+    }
+}
+
+void VirtualDesktopBarEngine::applyPendingInput() {
+    int n = backend->numberOfDesktops();
+    if (n < 1) {
+        return;
+    }
+
+    if (pendingSwitchNumber > 0 || pendingSwitchSteps != 0) {
+        int number = pendingSwitchNumber > 0 ? pendingSwitchNumber : shownDesktopNumber;
+        number += pendingSwitchSteps;
+        if (pendingSwitchWrap) {
+            number = ((number - 1) % n + n) % n + 1;
+        }
+
+        pendingSwitchNumber = 0;
+        pendingSwitchSteps = 0;
+        showDesktop(qBound(1, number, n));
+    }
+
+    if (pendingMoveSteps != 0) {
+        int fromNumber = shownDesktopNumber;
+        int toNumber = qBound(1, fromNumber + pendingMoveSteps, n);
+
+        pendingMoveSteps = 0;
+        moveDesktop(fromNumber, toNumber);
+    }
+
+    if (pendingWindowDesktopNumber > 0) {
+        WId id = backend->activeWindow();
+        if (id && pendingWindowDesktopNumber <= n) {
+            backend->setOnDesktop(id, pendingWindowDesktopNumber);
+        }
+        pendingWindowDesktopNumber = 0;
+    }
+}
+
+void VirtualDesktopBarEngine::removeDesktopsManually(const QList<int>& numbers) {
+    QList<int> desktopNumberList;
+    for (int i = 1; i <= backend->numberOfDesktops(); i++) {
+        if (!numbers.contains(i)) {
+            desktopNumberList << i;
+        }
+    }
+
+    applyDesktopPermutation(desktopNumberList);
+}
+
+void VirtualDesktopBarEngine::applyDesktopPermutation(const QList<int>& desktopNumberList) {
+    // Windows have to be known to be moved along with their desktops,
+    // so the change waits for the window scan, with refreshes held back
+    // to keep the order the applet already shows
+    if (!started) {
+        deferDesktopPermutation(desktopNumberList);
+        finishStartup();
+        return;
+    }
+
+    int oldNumberOfDesktops = backend->numberOfDesktops();
+    int newNumberOfDesktops = desktopNumberList.length();
+    if (newNumberOfDesktops < 1) {
+        return;
+    }
+
+    QVector<int> targetNumbers(oldNumberOfDesktops + 1, 0);
+    for (int i = 0; i < newNumberOfDesktops; i++) {
+        int number = desktopNumberList[i];
+        if (number < 1 || number > oldNumberOfDesktops || targetNumbers[number] != 0) {
+            return;
+        }
+        targetNumbers[number] = i + 1;
+    }
+
+    // Windows of a removed desktop go where the next remaining desktop goes
+    for (int i = oldNumberOfDesktops, nextTargetNumber = newNumberOfDesktops; i >= 1; i--) {
+        if (targetNumbers[i] == 0) {
+            targetNumbers[i] = nextTargetNumber;
+        } else {
+            nextTargetNumber = targetNumbers[i];
+        }
+    }
+
+    // Names are the ones the transaction is later checked against
+    QList<QString> desktopNameList;
+    for (int number : desktopNumberList) {
+        desktopNameList << desktopManager.getDesktopInfo(number).name;
+    }
+
+    QList<QPair<WId, int>> windowMoveList;
+    for (int i = 1; i <= oldNumberOfDesktops; i++) {
+        if (targetNumbers[i] == i) {
+            continue;
+        }
+        for (auto& windowInfo : windowIndex.getWindowInfoList(i)) {
+            if (windowInfo.desktop == i) {
+                windowMoveList << qMakePair(windowInfo.id, targetNumbers[i]);
+            }
+        }
+    }
+
+    finishDesktopTransaction();
+    changeScheduler.hold();
+
+    // KWin's own interface is preferred, as it's what confirms the names
+    for (int i = 0; i < newNumberOfDesktops; i++) {
+        if (desktopManager.getDesktopInfo(i + 1).name == desktopNameList[i]) {
+            continue;
+        }
+        if (desktopManager.isUsingFallback()) {
+            backend->setDesktopName(i + 1, desktopNameList[i]);
+        } else {
+            desktopManager.renameDesktop(i + 1, desktopNameList[i]);
+        }
+    }
+
+    for (auto& windowMove : windowMoveList) {
+        backend->setOnDesktop(windowMove.first, windowMove.second);
+    }
+
+    int currentNumber = backend->currentDesktop();
+    if (currentNumber >= 1 && currentNumber <= oldNumberOfDesktops &&
+        targetNumbers[currentNumber] != currentNumber) {
+        backend->setCurrentDesktop(targetNumbers[currentNumber]);
+    }
+
+    if (newNumberOfDesktops != oldNumberOfDesktops) {
+        backend->setNumberOfDesktops(newNumberOfDesktops);
+    }
+
+    // Changes keep coming from the X server for a while, and running a pass
+    // in between would see half of them, e.g. windows moved away but desktops
+    // not removed yet, so it waits for the final desktop table instead
+    desktopTransactionPending = true;
+    desktopTransactionNameList = desktopNameList;
+    desktopTransactionTimer.start();
+}
+
+void VirtualDesktopBarEngine::deferDesktopPermutation(const QList<int>& desktopNumberList) {
+    if (pendingDesktopNumberList.isEmpty()) {
+        pendingDesktopNumberList = desktopNumberList;
+        changeScheduler.hold();
+        return;
+    }
+
+    // Numbers of a later change refer to the order the earlier one makes
+    QList<int> composedNumberList;
+    for (int number : desktopNumberList) {
+        if (number < 1 || number > pendingDesktopNumberList.length()) {
+            return;
+        }
+        composedNumberList << pendingDesktopNumberList[number - 1];
+    }
+    pendingDesktopNumberList = composedNumberList;
+}
+
+bool VirtualDesktopBarEngine::isDesktopTransactionSettled() const {
+    if (desktopManager.getNumberOfDesktops() != desktopTransactionNameList.length()) {
+        return false;
+    }
+
+    for (int i = 0; i < desktopTransactionNameList.length(); i++) {
+        if (desktopManager.getDesktopInfo(i + 1).name != desktopTransactionNameList[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void VirtualDesktopBarEngine::finishDesktopTransaction() {
+    if (!desktopTransactionPending) {
+        return;
+    }
+
+    desktopTransactionPending = false;
+    desktopTransactionNameList.clear();
+    desktopTransactionTimer.stop();
+    changeScheduler.release();
+}
+
+void VirtualDesktopBarEngine::setUpSignals() {
+    setUpKWinSignals();
+    setUpInternalSignals();
+}
+
+void VirtualDesktopBarEngine::setUpKWinSignals() {
+    // Nothing else depends on the current desktop, so windows aren't rescanned
+    QObject::connect(backend, &WindowSystemBackend::currentDesktopChanged, this, [&] {
+        int previousDesktopNumber = currentDesktopNumber;
+        updateLocalDesktopNumbers();
+        if (currentDesktopNumber != previousDesktopNumber) {
+            hookRunner.run(HookRunner::DesktopSwitched,
+                           desktopManager.getDesktopInfo(currentDesktopNumber),
+                           previousDesktopNumber);
+
+            // Published by the next pass, along with anything else it brings
+            processChanges(ChangeScheduler::PublishState,
+                           Statistics::TriggersFromDesktops);
+        }
+
+        // Switches made in a quick succession confirm each other on the way
+        if (desktopSwitchTimer.isActive() && currentDesktopNumber != shownDesktopNumber) {
+            return;
+        }
+        desktopSwitchTimer.stop();
+        updateShownDesktopNumber(currentDesktopNumber);
+    });
+
+    QObject::connect(&desktopManager, &DesktopManager::desktopsChanged, this, [&] {
+        if (desktopTransactionPending && isDesktopTransactionSettled()) {
+            finishDesktopTransaction();
+        }
+        updateKnownDesktops();
+        updateDesktopEmptiness();
+        if (numberOfDesktops != desktopManager.getNumberOfDesktops()) {
+            numberOfDesktops = desktopManager.getNumberOfDesktops();
+            processChanges(ChangeScheduler::AllTasks,
+                           Statistics::TriggersFromDesktops);
+            return;
+        }
+        processChanges(ChangeScheduler::SendDesktopInfoList,
+                       Statistics::TriggersFromDesktops);
+    });
+
+    QObject::connect(&windowIndex, &WindowIndex::rebuilt, this, [&] {
+        if (started) {
+            return;
+        }
+
+        started = true;
+        Statistics::get().recordPhase(Statistics::WindowScan, windowScanTimer.nsecsElapsed());
+
+        if (!pendingDesktopNumberList.isEmpty()) {
+            auto desktopNumberList = pendingDesktopNumberList;
+            pendingDesktopNumberList.clear();
+            applyDesktopPermutation(desktopNumberList);
+            changeScheduler.release();
+        }
+
+        // A simulated session must not take over the real session's shortcuts
+        if (backend->isLiveSession()) {
+            QTimer::singleShot(shortcutRegistrationDelay, this, [&] {
+                QElapsedTimer timer;
+                timer.start();
+                setUpGlobalKeyboardShortcuts();
+                Statistics::get().recordPhase(Statistics::ShortcutRegistration, timer.nsecsElapsed());
+            });
+        }
+    });
+
+    QObject::connect(&windowIndex, &WindowIndex::occupancyChanged, this, [&] {
+        updateDesktopEmptiness();
+        processChanges(ChangeScheduler::AllTasks,
+                       Statistics::TriggersFromOccupancy);
+    });
+
+    // Only the window that changed is matched against the rules
+    QObject::connect(&windowIndex, &WindowIndex::windowUpdated, this, [&](WId id, NET::Properties properties) {
+        if (!windowRules.isEmpty() && (properties & (NET::WMName | NET::WMWindowType))) {
+            applyWindowRules(id);
+        }
+    });
+
+    QObject::connect(backend, &WindowSystemBackend::windowRemoved, this, [&](WId id) {
+        windowRules.forgetWindow(id);
+    });
+
+    QObject::connect(&windowIndex, &WindowIndex::screensChanged, this, [&] {
+        processChanges(ChangeScheduler::SendDesktopInfoList,
+                       Statistics::TriggersFromScreens);
+    });
+
+    // Applets filter windows by their screens on their own, so any change
+    // of a window's screens is passed on, even if nobody filters at all,
+    // while names matter only to labels showing them
+    QObject::connect(&windowIndex, &WindowIndex::windowInfoChanged, this, [&](NET::Properties properties) {
+        NET::Properties refreshedProperties = NET::WMState | NET::WMGeometry;
+        if (!windowNameClientSet.isEmpty()) {
+            refreshedProperties |= NET::WMName;
+        }
+        if (properties & refreshedProperties) {
+            processChanges(ChangeScheduler::SendDesktopInfoList,
+                           Statistics::TriggersFromWindowInfo);
+        }
+    });
+}
+
+void VirtualDesktopBarEngine::setUpInternalSignals() {
+    QObject::connect(&desktopTransactionTimer, &QTimer::timeout, this, [&] {
+        finishDesktopTransaction();
+    });
+
+    QObject::connect(&startupTimer, &QTimer::timeout, this, [&] {
+        finishStartup();
+    });
+
+    QObject::connect(&inputTimer, &QTimer::timeout, this, [&] {
+        applyPendingInput();
+    });
+
+    QObject::connect(&desktopSwitchTimer, &QTimer::timeout, this, [&] {
+        updateShownDesktopNumber(backend->currentDesktop());
+    });
+
+    QObject::connect(&changeScheduler, &ChangeScheduler::passTriggered, this, [&](ChangeScheduler::Tasks tasks) {
+        // Every desktop looks empty before windows are scanned, so the
+        // automation waits for the pass which follows the scan
+        if (!started) {
+            tasks &= ChangeScheduler::SendDesktopInfoList | ChangeScheduler::PublishState;
+        }
+
+        // All tasks of a pass share the same view of empty desktops
+        if (tasks & (ChangeScheduler::AddEmptyDesktop | ChangeScheduler::RemoveEmptyDesktops)) {
+            auto emptyDesktopNumberList = getEmptyDesktopNumberList(false);
+            if (tasks & ChangeScheduler::AddEmptyDesktop) {
+                tryAddEmptyDesktop(emptyDesktopNumberList);
+            }
+            if (tasks & ChangeScheduler::RemoveEmptyDesktops) {
+                tryRemoveEmptyDesktops(emptyDesktopNumberList);
+            }
+        }
+        if (tasks & ChangeScheduler::RenameEmptyDesktops) {
+            tryRenameEmptyDesktops(getEmptyDesktopNumberList());
+        }
+        if (tasks & ChangeScheduler::SendDesktopInfoList) {
+            Statistics::get().increment(Statistics::RefreshPasses);
+            emit refreshRequested();
+        }
+        if (tasks & (ChangeScheduler::SendDesktopInfoList | ChangeScheduler::PublishState)) {
+            publishState();
+        }
+    });
+
+    QObject::connect(&desktopManager, &DesktopManager::operationFinished,
+                     this, &VirtualDesktopBarEngine::desktopOperationFinished);
+
+    QObject::connect(&desktopManager, &DesktopManager::operationFailed,
+                     this, &VirtualDesktopBarEngine::desktopOperationFailed);
+}
+
+void VirtualDesktopBarEngine::setUpTracing() {
+    QString recordFilePath = QString::fromLocal8Bit(qgetenv("VIRTUALDESKTOPBAR_RECORD_TRACE"));
+    if (!recordFilePath.isEmpty()) {
+        new TraceRecorder(backend, recordFilePath, this);
+    }
+
+    // Replaying makes sense only without the real window system
+    QString replayFilePath = QString::fromLocal8Bit(qgetenv("VIRTUALDESKTOPBAR_REPLAY_TRACE"));
+    auto simulatedBackend = getSimulatedBackend();
+    if (!replayFilePath.isEmpty() && simulatedBackend) {
+        bool ok;
+        double speed = qgetenv("VIRTUALDESKTOPBAR_REPLAY_SPEED").toDouble(&ok);
+        new TraceReplayer(simulatedBackend, &changeScheduler, replayFilePath, ok ? speed : 1, this);
+    }
+}
+
+void VirtualDesktopBarEngine::setUpGlobalKeyboardShortcuts() {
+    QString prefix = "Virtual Desktop Bar - ";
+    actionCollection = new KActionCollection(this, QStringLiteral("kwin"));
+
+    actionSwitchToRecentDesktop = actionCollection->addAction(QStringLiteral("switchToRecentDesktop"));
+    actionSwitchToRecentDesktop->setText(prefix + "Switch to Recent Desktop");
+    QObject::connect(actionSwitchToRecentDesktop, &QAction::triggered, this, [&] {
+        switchToDesktop(mostRecentDesktopNumber);
+    });
+    KGlobalAccel::setGlobalShortcut(actionSwitchToRecentDesktop, QKeySequence());
+
+    actionAddDesktop = actionCollection->addAction(QStringLiteral("addDesktop"));
+    actionAddDesktop->setText(prefix + "Add Desktop");
+    QObject::connect(actionAddDesktop, &QAction::triggered, this, [&] {
+        if (!dynamicDesktopsEnable) {
+            addDesktop();
+        }
+    });
+    KGlobalAccel::setGlobalShortcut(actionAddDesktop, QKeySequence());
+
+    actionRemoveLastDesktop = actionCollection->addAction(QStringLiteral("removeLastDesktop"));
+    actionRemoveLastDesktop->setText(prefix + "Remove Last Desktop");
+    QObject::connect(actionRemoveLastDesktop, &QAction::triggered, this, [&] {
+        if (!dynamicDesktopsEnable) {
+            removeDesktops({ backend->numberOfDesktops() });
+        }
+    });
+    KGlobalAccel::setGlobalShortcut(actionRemoveLastDesktop, QKeySequence());
+
+    actionRemoveCurrentDesktop = actionCollection->addAction(QStringLiteral("removeCurrentDesktop"));
+    actionRemoveCurrentDesktop->setText(prefix + "Remove Current Desktop");
+    QObject::connect(actionRemoveCurrentDesktop, &QAction::triggered, this, [&] {
+        if (!dynamicDesktopsEnable) {
+            removeDesktops({ backend->currentDesktop() });
+        }
+    });
+    KGlobalAccel::setGlobalShortcut(actionRemoveCurrentDesktop, QKeySequence());
+
+    actionRenameCurrentDesktop = actionCollection->addAction(QStringLiteral("renameCurrentDesktop"));
+    actionRenameCurrentDesktop->setText(prefix + "Rename Current Desktop");
+    QObject::connect(actionRenameCurrentDesktop, &QAction::triggered, this, [&] {
+        emit requestRenameCurrentDesktop();
+    });
+    KGlobalAccel::setGlobalShortcut(actionRenameCurrentDesktop, QKeySequence());
+
+    actionMoveCurrentDesktopToLeft = actionCollection->addAction(QStringLiteral("moveCurrentDesktopToLeft"));
+    actionMoveCurrentDesktopToLeft->setText(prefix + "Move Current Desktop to Left");
+    QObject::connect(actionMoveCurrentDesktopToLeft, &QAction::triggered, this, [&] {
+        moveCurrentDesktopBy(-1);
+    });
+    KGlobalAccel::setGlobalShortcut(actionMoveCurrentDesktopToLeft, QKeySequence());
+
+    actionMoveCurrentDesktopToRight = actionCollection->addAction(QStringLiteral("moveCurrentDesktopToRight"));
+    actionMoveCurrentDesktopToRight->setText(prefix + "Move Current Desktop to Right");
+    QObject::connect(actionMoveCurrentDesktopToRight, &QAction::triggered, this, [&] {
+        moveCurrentDesktopBy(1);
+    });
+    KGlobalAccel::setGlobalShortcut(actionMoveCurrentDesktopToRight, QKeySequence());
+
+    // Built once, instead of following the number of desktops
+    for (int i = 1; i <= numberOfDesktopActions; i++) {
+        auto actionSwitchToDesktop = actionCollection->addAction(QStringLiteral("switchToDesktop%1").arg(i));
+        actionSwitchToDesktop->setText(prefix + QStringLiteral("Switch to Desktop %1").arg(i));
+        QObject::connect(actionSwitchToDesktop, &QAction::triggered, this, [=] {
+            if (i <= backend->numberOfDesktops()) {
+                switchToDesktop(i);
+            }
+        });
+        KGlobalAccel::setGlobalShortcut(actionSwitchToDesktop, QKeySequence());
+        actionSwitchToDesktopList << actionSwitchToDesktop;
+
+        auto actionMoveWindowToDesktop = actionCollection->addAction(QStringLiteral("moveWindowToDesktop%1").arg(i));
+        actionMoveWindowToDesktop->setText(prefix + QStringLiteral("Move Window to Desktop %1").arg(i));
+        QObject::connect(actionMoveWindowToDesktop, &QAction::triggered, this, [=] {
+            moveActiveWindowToDesktop(i);
+        });
+        KGlobalAccel::setGlobalShortcut(actionMoveWindowToDesktop, QKeySequence());
+        actionMoveWindowToDesktopList << actionMoveWindowToDesktop;
+    }
+}
+
+void VirtualDesktopBarEngine::processChanges(ChangeScheduler::Tasks tasks, Statistics::Counter source) {
+    Statistics::get().increment(source);
+    changeScheduler.schedule(tasks);
+}
+
+QList<int> VirtualDesktopBarEngine::getEmptyDesktopNumberList(bool noCheating) {
+    QList<int> emptyDesktopNumberList;
+
+    for (int i = 1; i <= desktopManager.getNumberOfDesktops(); i++) {
+        if (windowIndex.isDesktopEmpty(i, noCheating)) {
+            emptyDesktopNumberList << i;
+        }
+    }
+
+    return emptyDesktopNumberList;
+}
+
+void VirtualDesktopBarEngine::tryAddEmptyDesktop(const QList<int>& emptyDesktopNumberList) {
+    if (dynamicDesktopsEnable) {
+        if (emptyDesktopNumberList.empty()) {
+            Statistics::get().increment(Statistics::AutomationDesktopsAdded);
+            addDesktop();
+        }
+    }
+}
+
+void VirtualDesktopBarEngine::tryRemoveEmptyDesktops(const QList<int>& emptyDesktopNumberList) {
+    if (dynamicDesktopsEnable) {
+        // The first empty desktop stays, all the others go at once
+        auto numbers = emptyDesktopNumberList.mid(1);
+        Statistics::get().increment(Statistics::AutomationDesktopsRemoved, numbers.length());
+        removeDesktops(numbers);
+    }
+}
+
+void VirtualDesktopBarEngine::tryRenameEmptyDesktops(const QList<int>& emptyDesktopNumberList) {
+    if (!emptyDesktopsRenameAs.isEmpty()) {
+        for (int desktopNumber : emptyDesktopNumberList) {
+            if (desktopManager.getDesktopInfo(desktopNumber).name != emptyDesktopsRenameAs) {
+                Statistics::get().increment(Statistics::AutomationDesktopsRenamed);
+                renameDesktop(desktopNumber, emptyDesktopsRenameAs);
+            }
+        }
+    }
+}
+
+void VirtualDesktopBarEngine::applyWindowRules(WId id) {
+    auto windowInfoPointer = windowIndex.getWindowInfo(id);
+    if (!windowInfoPointer) {
+        return;
+    }
+    WindowInfo windowInfo = *windowInfoPointer;
+
+    auto actions = windowRules.evaluate(windowInfo);
+    if (actions.isEmpty()) {
+        return;
+    }
+    Statistics::get().increment(Statistics::AutomationWindowRulesApplied);
+
+    int desktopNumber = windowInfo.desktop;
+    if (actions.pin) {
+        backend->setOnDesktop(id, NET::OnAllDesktops);
+    } else if (actions.desktop > 0 && actions.desktop <= backend->numberOfDesktops() &&
+               actions.desktop != desktopNumber) {
+        backend->setOnDesktop(id, actions.desktop);
+        desktopNumber = actions.desktop;
+    }
+
+    if (actions.renameDesktop && desktopNumber >= 1 && !windowInfo.windowClass.isEmpty() &&
+        desktopManager.getDesktopInfo(desktopNumber).name != windowInfo.windowClass) {
+        renameDesktop(desktopNumber, windowInfo.windowClass);
+    }
+}
+
+void VirtualDesktopBarEngine::updateKnownDesktops() {
+    QHash<QString, DesktopInfo> desktopInfoMap;
+    for (auto& desktopInfo : desktopManager.getDesktopInfoList()) {
+        desktopInfoMap.insert(desktopInfo.id, desktopInfo);
+    }
+
+    bool isComparable = !knownDesktopInfoMap.isEmpty() &&
+                        knownDesktopsUsingFallback == desktopManager.isUsingFallback();
+
+    if (isComparable) {
+        for (auto& desktopInfo : knownDesktopInfoMap) {
+            if (!desktopInfoMap.contains(desktopInfo.id)) {
+                hookRunner.run(HookRunner::DesktopRemoved, desktopInfo);
+            }
+        }
+
+        if (addingDesktopCount > 0 && addingDesktopTimer.elapsed() > desktopTransactionTimeout) {
+            addingDesktopCount = 0;
+        }
+
+        for (auto& desktopInfo : desktopInfoMap) {
+            if (knownDesktopInfoMap.contains(desktopInfo.id)) {
+                continue;
+            }
+
+            hookRunner.run(HookRunner::DesktopAdded, desktopInfo);
+
+            // Delayed like before, to let the applet switch to the desktop first,
+            // and left in the foreground for the hook worker to throttle
+            if (addingDesktopCount > 0) {
+                addingDesktopCount--;
+                QString command = addingDesktopsExecuteCommand;
+                QTimer::singleShot(100, this, [=] {
+                    hookRunner.runCommand(command, HookRunner::DesktopAdded, desktopInfo);
+                });
+            }
+        }
+    }
+
+    knownDesktopInfoMap = desktopInfoMap;
+    knownDesktopsUsingFallback = desktopManager.isUsingFallback();
+}
+
+void VirtualDesktopBarEngine::updateDesktopEmptiness() {
+    if (!started) {
+        return;
+    }
+
+    if (!hookRunner.hasCommand(HookRunner::DesktopBecameEmpty) &&
+        !hookRunner.hasCommand(HookRunner::DesktopBecameOccupied)) {
+        desktopEmptinessMap.clear();
+        return;
+    }
+
+    QHash<QString, bool> emptinessMap;
+    for (int i = 1; i <= desktopManager.getNumberOfDesktops(); i++) {
+        auto desktopInfo = desktopManager.getDesktopInfo(i);
+        bool isEmpty = windowIndex.isDesktopEmpty(i);
+        emptinessMap.insert(desktopInfo.id, isEmpty);
+
+        auto it = desktopEmptinessMap.constFind(desktopInfo.id);
+        if (it != desktopEmptinessMap.constEnd() && it.value() != isEmpty) {
+            hookRunner.run(isEmpty ? HookRunner::DesktopBecameEmpty :
+                                     HookRunner::DesktopBecameOccupied, desktopInfo);
+        }
+    }
+
+    desktopEmptinessMap = emptinessMap;
+}
+
+void VirtualDesktopBarEngine::publishState() {
+    // Occupancy isn't known before windows are scanned
+    if (!stateExporter || !started) {
+        return;
+    }
+
+    QStringList desktopIds;
+    QStringList desktopNames;
+    QList<int> occupiedDesktops;
+    QList<int> urgentDesktops;
+
+    for (int i = 1; i <= desktopManager.getNumberOfDesktops(); i++) {
+        auto desktopInfo = desktopManager.getDesktopInfo(i);
+        desktopIds << desktopInfo.id;
+        desktopNames << desktopInfo.name;
+
+        if (windowIndex.isDesktopEmpty(i)) {
+            continue;
+        }
+        occupiedDesktops << i;
+
+        for (auto& windowInfo : windowIndex.getWindowInfoList(i)) {
+            if (windowInfo.hasState(NET::DemandsAttention)) {
+                urgentDesktops << i;
+                break;
+            }
+        }
+    }
+
+    stateExporter->update(currentDesktopNumber, desktopIds, desktopNames, occupiedDesktops, urgentDesktops);
+}
+
+void VirtualDesktopBarEngine::updateShownDesktopNumber(int number) {
+    if (shownDesktopNumber != number) {
+        int oldNumber = shownDesktopNumber;
+        shownDesktopNumber = number;
+        emit currentDesktopChanged(oldNumber, number);
+    }
+}
+
+void VirtualDesktopBarEngine::updateLocalDesktopNumbers() {
+    int n = backend->currentDesktop();
+    if (currentDesktopNumber != n) {
+        mostRecentDesktopNumber = currentDesktopNumber;
+    }
+    currentDesktopNumber = n;
+}
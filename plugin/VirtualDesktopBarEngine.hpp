@@ -0,0 +1,209 @@
+#pragma once
+
+#include <QAction>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+#include <KActionCollection>
+
+#include "ChangeScheduler.hpp"
+#include "DesktopManager.hpp"
+#include "HookRunner.hpp"
+#include "StateExporter.hpp"
+#include "Statistics.hpp"
+#include "StatisticsExporter.hpp"
+#include "WindowIndex.hpp"
+#include "WindowRules.hpp"
+#include "WindowSystemBackend.hpp"
+
+class SimulatedBackend;
+
+// Keeps the window and desktop state, the automation and the global
+// shortcuts once per process, no matter how many applets are there
+class VirtualDesktopBarEngine : public QObject {
+    Q_OBJECT
+
+public:
+    // The engine lives as long as at least one applet holds it
+    static QSharedPointer<VirtualDesktopBarEngine> getInstance();
+
+    const WindowSystemBackend& getBackend() const;
+    const DesktopManager& getDesktopManager() const;
+    const WindowIndex& getWindowIndex() const;
+    const ChangeScheduler& getChangeScheduler() const;
+
+    // Null unless the session is simulated, e.g. in tests
+    SimulatedBackend* getSimulatedBackend() const;
+
+    // The engine starts with desktops only, so that applets can show them
+    // right away, and scans windows in the background once the first applet
+    // is on screen, or after a timeout if none reports it, with shortcuts
+    // coming last; it's started when the scan is done
+    void finishStartup();
+    bool isStarted() const;
+
+    // The desktop being switched to counts as current right away
+    int getCurrentDesktopNumber() const;
+
+    void showDesktop(int number);
+    void addDesktop();
+    void removeDesktops(const QList<int>& numbers);
+    void renameDesktop(int number, const QString& name);
+    void moveDesktop(int fromNumber, int toNumber);
+
+    // Requests coming in bursts, e.g. from scrolling or held shortcuts,
+    // are collected and carried out once per frame as a single change
+    void switchToDesktop(int number);
+    void switchDesktopBy(int steps, bool wrap);
+    void moveCurrentDesktopBy(int steps);
+    void moveActiveWindowToDesktop(int number);
+
+    void scheduleRefresh();
+
+    // Refreshes are held back, e.g. while an applet previews a change
+    void holdChanges();
+    void releaseChanges();
+
+    // Name changes of windows are refreshed only while an applet shows them
+    void setWindowNamesShown(const QObject* client, bool shown);
+
+    // Only one applet configures the automation, the next one takes over
+    // after it's gone, which is announced by the automationReleased signal
+    bool claimAutomation(const QObject* client);
+    void releaseAutomation(const QObject* client);
+    bool isAutomationOwner(const QObject* client) const;
+
+    void setEmptyDesktopsRenameAs(const QString& name);
+    void setAddingDesktopsExecuteCommand(const QString& command);
+    void setHookCommand(HookRunner::Hook hook, const QString& command);
+    void setWindowRules(const QStringList& ruleStringList);
+    void setDynamicDesktopsEnable(bool enable);
+    void setRefreshMinimumInterval(int milliseconds);
+    void setRefreshMaximumLatency(int milliseconds);
+    void setKWinLatencyBudget(int milliseconds);
+
+signals:
+    void refreshRequested();
+    void currentDesktopChanged(int oldNumber, int newNumber);
+    void automationReleased();
+
+    void requestRenameCurrentDesktop();
+
+    void desktopOperationFinished(QString operation, int number);
+    void desktopOperationFailed(QString operation, int number, QString errorMessage);
+
+private:
+    VirtualDesktopBarEngine();
+
+    // Detaches the engine from the session once the last applet is gone
+    void shutDown();
+
+    WindowSystemBackend* backend;
+    DesktopManager desktopManager;
+    WindowIndex windowIndex;
+    ChangeScheduler changeScheduler;
+    StatisticsExporter* statisticsExporter;
+    StateExporter* stateExporter;
+
+    // Run as part of passes only, so that each pass makes one generation at most
+    void publishState();
+
+    bool started;
+    QTimer startupTimer;
+    QElapsedTimer windowScanTimer;
+
+    void setUpSignals();
+    void setUpKWinSignals();
+    void setUpInternalSignals();
+    void setUpGlobalKeyboardShortcuts();
+
+    // Traces are recorded and replayed as set by environment variables
+    void setUpTracing();
+
+    void removeDesktopsManually(const QList<int>& numbers);
+
+    // Rearranges desktops so that the new desktop N is the old desktop
+    // at position N-1 in the list, and desktops not on the list are removed
+    void applyDesktopPermutation(const QList<int>& desktopNumberList);
+
+    // Rearrangements made before the window scan are carried out after it
+    QList<int> pendingDesktopNumberList;
+    void deferDesktopPermutation(const QList<int>& desktopNumberList);
+
+    QTimer desktopTransactionTimer;
+    bool desktopTransactionPending;
+    QList<QString> desktopTransactionNameList;
+    bool isDesktopTransactionSettled() const;
+    void finishDesktopTransaction();
+
+    // A switch is shown before KWin confirms it, and undone if it doesn't
+    QTimer desktopSwitchTimer;
+    int shownDesktopNumber;
+    void updateShownDesktopNumber(int number);
+
+    QTimer inputTimer;
+    int pendingSwitchNumber;
+    int pendingSwitchSteps;
+    bool pendingSwitchWrap;
+    int pendingMoveSteps;
+    int pendingWindowDesktopNumber;
+    void scheduleInput();
+    void applyPendingInput();
+
+    const QObject* automationOwner;
+
+    QSet<const QObject*> windowNameClientSet;
+
+    QString emptyDesktopsRenameAs;
+    QString addingDesktopsExecuteCommand;
+    bool dynamicDesktopsEnable;
+
+    HookRunner hookRunner;
+
+    // Rules apply to windows showing up or changing after they are set
+    WindowRules windowRules;
+    void applyWindowRules(WId id);
+
+    // The adding command runs only for desktops added by the applet
+    int addingDesktopCount;
+    QElapsedTimer addingDesktopTimer;
+
+    // Hooks are run for changes between two known states, so nothing
+    // is reported when the desktop table is loaded or its ids change
+    QHash<QString, DesktopInfo> knownDesktopInfoMap;
+    bool knownDesktopsUsingFallback;
+    QHash<QString, bool> desktopEmptinessMap;
+    void updateKnownDesktops();
+    void updateDesktopEmptiness();
+
+    // Every request for a pass is counted by the source which made it
+    void processChanges(ChangeScheduler::Tasks tasks, Statistics::Counter source);
+
+    QList<int> getEmptyDesktopNumberList(bool noCheating = true);
+    void tryAddEmptyDesktop(const QList<int>& emptyDesktopNumberList);
+    void tryRemoveEmptyDesktops(const QList<int>& emptyDesktopNumberList);
+    void tryRenameEmptyDesktops(const QList<int>& emptyDesktopNumberList);
+
+    int numberOfDesktops;
+    int currentDesktopNumber;
+    int mostRecentDesktopNumber;
+    void updateLocalDesktopNumbers();
+
+    KActionCollection* actionCollection;
+    QAction* actionSwitchToRecentDesktop;
+    QAction* actionAddDesktop;
+    QAction* actionRemoveLastDesktop;
+    QAction* actionRemoveCurrentDesktop;
+    QAction* actionRenameCurrentDesktop;
+    QAction* actionMoveCurrentDesktopToLeft;
+    QAction* actionMoveCurrentDesktopToRight;
+    QList<QAction*> actionSwitchToDesktopList;
+    QList<QAction*> actionMoveWindowToDesktopList;
+};
@@ -2,8 +2,13 @@
 
 #include <QQmlEngine>
 
+#include "DesktopButtonStrip.hpp"
+#include "DesktopListModel.hpp"
 #include "VirtualDesktopBar.hpp"
 
 void VirtualDesktopBarPlugin::registerTypes(const char* uri) {
     qmlRegisterType<VirtualDesktopBar>(uri, 1, 2, "VirtualDesktopBar");
+    qmlRegisterType<DesktopButtonStrip>(uri, 1, 2, "DesktopButtonStrip");
+    qmlRegisterUncreatableType<DesktopListModel>(uri, 1, 2, "DesktopListModel",
+                                                 "DesktopListModel is provided by VirtualDesktopBar");
 }
@@ -0,0 +1,354 @@
+#include "WindowIndex.hpp"
+
+#include <QGuiApplication>
+
+#include <algorithm>
+
+const NET::Properties WindowIndex::trackedProperties = NET::WMState |
+                                                       NET::WMDesktop |
+                                                       NET::WMGeometry |
+                                                       NET::WMWindowType |
+                                                       NET::WMName;
+
+WindowIndex::WindowIndex(WindowSystemBackend* backend, QObject* parent) : QObject(parent),
+        backend(backend),
+        rebuildPending(false),
+        stackingRanksOutdated(true) {
+    setUpSignals();
+    updateScreenGeometryList();
+}
+
+void WindowIndex::rebuild() {
+    rebuildPending = true;
+    windowsChangedDuringRebuild.clear();
+    backend->requestSnapshot();
+}
+
+const WindowInfo* WindowIndex::getWindowInfo(WId id) const {
+    auto it = windowInfoMap.constFind(id);
+    return it != windowInfoMap.constEnd() ? &it.value() : nullptr;
+}
+
+QList<WindowInfo> WindowIndex::getWindowInfoList(int desktopNumber) const {
+    QList<WindowInfo> windowInfoList;
+
+    auto bucket = desktopBuckets.value(desktopNumber);
+    auto stickyBucket = desktopBuckets.value(NET::OnAllDesktops);
+    if (bucket.isEmpty() && stickyBucket.isEmpty()) {
+        return windowInfoList;
+    }
+
+    // Only the windows of the desktop are looked at, ordered by rank,
+    // instead of the whole stacking order for every desktop
+    updateStackingRanks();
+
+    QList<QPair<int, WId>> rankedWindowIds;
+    rankedWindowIds.reserve(bucket.size() + stickyBucket.size());
+    for (auto windowIds : { &bucket, &stickyBucket }) {
+        for (WId id : *windowIds) {
+            auto it = stackingRanks.constFind(id);
+            if (it != stackingRanks.constEnd()) {
+                rankedWindowIds << qMakePair(it.value(), id);
+            }
+        }
+    }
+
+    // Top of the stack first
+    std::sort(rankedWindowIds.begin(), rankedWindowIds.end(),
+              [](const QPair<int, WId>& a, const QPair<int, WId>& b) {
+        return a.first > b.first;
+    });
+
+    windowInfoList.reserve(rankedWindowIds.length());
+    for (auto& rankedWindowId : rankedWindowIds) {
+        windowInfoList << windowInfoMap.value(rankedWindowId.second);
+    }
+
+    return windowInfoList;
+}
+
+bool WindowIndex::isDesktopEmpty(int desktopNumber, bool includeSticky) const {
+    if (!desktopBuckets.value(desktopNumber).isEmpty()) {
+        return false;
+    }
+
+    return !includeSticky || desktopBuckets.value(NET::OnAllDesktops).isEmpty();
+}
+
+int WindowIndex::getScreenIndex(const QRect& screenGeometry) const {
+    int screenIndex = 0;
+    int largestArea = 0;
+
+    for (int i = 0; i < screenGeometryList.length(); i++) {
+        if (screenGeometryList[i] == screenGeometry) {
+            return i;
+        }
+
+        auto intersectionRect = screenGeometryList[i].intersected(screenGeometry);
+        int area = intersectionRect.width() * intersectionRect.height();
+        if (area > largestArea) {
+            largestArea = area;
+            screenIndex = i;
+        }
+    }
+
+    return screenIndex;
+}
+
+void WindowIndex::updateStackingRanks() const {
+    if (!stackingRanksOutdated) {
+        return;
+    }
+    stackingRanksOutdated = false;
+
+    // The stacking order is cached by the backend, so walking it is cheap
+    QList<WId> windowIds = backend->stackingOrder();
+    stackingRanks.clear();
+    stackingRanks.reserve(windowIds.length());
+    for (int i = 0; i < windowIds.length(); i++) {
+        stackingRanks.insert(windowIds[i], i);
+    }
+}
+
+void WindowIndex::setUpSignals() {
+    QObject::connect(backend, &WindowSystemBackend::snapshotReady, this, [&](WindowSnapshot snapshot) {
+        stackingRanksOutdated = true;
+        applySnapshot(snapshot);
+    });
+
+    QObject::connect(backend, &WindowSystemBackend::stackingOrderChanged, this, [&] {
+        stackingRanksOutdated = true;
+    });
+
+    // New windows may be announced before the order that includes them
+    QObject::connect(backend, &WindowSystemBackend::windowAdded, this, [&](WId id) {
+        stackingRanksOutdated = true;
+        addWindow(id);
+
+        auto windowInfo = getWindowInfo(id);
+        if (windowInfo && !windowInfo->isIgnored()) {
+            emit occupancyChanged();
+        }
+        if (windowInfo) {
+            emit windowUpdated(id, trackedProperties);
+        }
+    });
+
+    QObject::connect(backend, &WindowSystemBackend::windowRemoved, this, [&](WId id) {
+        auto windowInfo = getWindowInfo(id);
+        bool wasIgnored = !windowInfo || windowInfo->isIgnored();
+
+        removeWindow(id);
+
+        if (!wasIgnored) {
+            emit occupancyChanged();
+        }
+    });
+
+    QObject::connect(backend, &WindowSystemBackend::windowChanged, this, [&](WId id, NET::Properties properties) {
+        if (properties & trackedProperties) {
+            updateWindow(id, properties & trackedProperties);
+        }
+    });
+
+    for (auto screen : QGuiApplication::screens()) {
+        setUpScreenSignals(screen);
+    }
+
+    QObject::connect(qGuiApp, &QGuiApplication::screenAdded, this, [&](QScreen* screen) {
+        setUpScreenSignals(screen);
+        updateScreenGeometryList();
+    });
+
+    QObject::connect(qGuiApp, &QGuiApplication::screenRemoved, this, [&] {
+        updateScreenGeometryList();
+    });
+}
+
+void WindowIndex::setUpScreenSignals(QScreen* screen) {
+    QObject::connect(screen, &QScreen::geometryChanged, this, [&] {
+        updateScreenGeometryList();
+    });
+}
+
+void WindowIndex::updateScreenGeometryList() {
+    QList<QRect> newScreenGeometryList;
+    for (auto screen : QGuiApplication::screens()) {
+        newScreenGeometryList << screen->geometry();
+    }
+
+    if (newScreenGeometryList == screenGeometryList) {
+        return;
+    }
+    screenGeometryList = newScreenGeometryList;
+
+    for (auto& windowInfo : windowInfoMap) {
+        updateScreenMask(windowInfo);
+    }
+
+    emit screensChanged();
+}
+
+void WindowIndex::updateScreenMask(WindowInfo& windowInfo) const {
+    windowInfo.screenMask = 0;
+
+    auto& windowRect = windowInfo.geometry;
+    for (int i = 0; i < screenGeometryList.length() && i < 32; i++) {
+        auto intersectionRect = screenGeometryList[i].intersected(windowRect);
+        if (intersectionRect.width() >= windowRect.width() / 2 &&
+            intersectionRect.height() >= windowRect.height() / 2) {
+            windowInfo.screenMask |= 1u << i;
+        }
+    }
+}
+
+void WindowIndex::markChangedDuringRebuild(WId id) {
+    if (rebuildPending) {
+        windowsChangedDuringRebuild.insert(id);
+    }
+}
+
+void WindowIndex::applySnapshot(const WindowSnapshot& snapshot) {
+    if (!rebuildPending) {
+        return;
+    }
+    rebuildPending = false;
+
+    QHash<WId, WindowInfo> newWindowInfoMap;
+    for (auto windowInfo : snapshot.getWindowInfoList()) {
+        if (!windowsChangedDuringRebuild.contains(windowInfo.id)) {
+            windowInfo.updateShortName();
+            updateScreenMask(windowInfo);
+            newWindowInfoMap.insert(windowInfo.id, windowInfo);
+        }
+    }
+    for (WId id : windowsChangedDuringRebuild) {
+        auto it = windowInfoMap.constFind(id);
+        if (it != windowInfoMap.constEnd()) {
+            newWindowInfoMap.insert(id, it.value());
+        }
+    }
+    windowsChangedDuringRebuild.clear();
+
+    windowInfoMap = newWindowInfoMap;
+    desktopBuckets.clear();
+    for (auto& windowInfo : windowInfoMap) {
+        insertIntoBucket(windowInfo);
+    }
+
+    emit rebuilt();
+    emit occupancyChanged();
+}
+
+void WindowIndex::addWindow(WId id) {
+    markChangedDuringRebuild(id);
+
+    WindowInfo windowInfo;
+    if (!backend->fetchWindowInfo(id, trackedProperties, windowInfo)) {
+        return;
+    }
+    windowInfo.updateShortName();
+    updateScreenMask(windowInfo);
+
+    removeWindow(id);
+    windowInfoMap.insert(id, windowInfo);
+    insertIntoBucket(windowInfo);
+}
+
+void WindowIndex::removeWindow(WId id) {
+    markChangedDuringRebuild(id);
+
+    auto it = windowInfoMap.find(id);
+    if (it == windowInfoMap.end()) {
+        return;
+    }
+
+    removeFromBucket(it.value());
+    windowInfoMap.erase(it);
+}
+
+void WindowIndex::updateWindow(WId id, NET::Properties properties) {
+    markChangedDuringRebuild(id);
+
+    auto it = windowInfoMap.find(id);
+    if (it == windowInfoMap.end()) {
+        addWindow(id);
+        emit occupancyChanged();
+        if (getWindowInfo(id)) {
+            emit windowUpdated(id, trackedProperties);
+        }
+        return;
+    }
+
+    // Fetching only the properties reported as changed
+    WindowInfo fetchedWindowInfo;
+    if (!backend->fetchWindowInfo(id, properties, fetchedWindowInfo)) {
+        return;
+    }
+
+    WindowInfo windowInfo = it.value();
+    NET::Properties changedProperties;
+
+    if ((properties & NET::WMDesktop) && windowInfo.desktop != fetchedWindowInfo.desktop) {
+        windowInfo.desktop = fetchedWindowInfo.desktop;
+        changedProperties |= NET::WMDesktop;
+    }
+    if ((properties & NET::WMState) && windowInfo.state != fetchedWindowInfo.state) {
+        windowInfo.state = fetchedWindowInfo.state;
+        changedProperties |= NET::WMState;
+    }
+    if ((properties & NET::WMWindowType) && windowInfo.type != fetchedWindowInfo.type) {
+        windowInfo.type = fetchedWindowInfo.type;
+        windowInfo.windowClass = fetchedWindowInfo.windowClass;
+        changedProperties |= NET::WMWindowType;
+    }
+    if ((properties & NET::WMGeometry) && windowInfo.geometry != fetchedWindowInfo.geometry) {
+        windowInfo.geometry = fetchedWindowInfo.geometry;
+        updateScreenMask(windowInfo);
+        if (windowInfo.screenMask != it.value().screenMask) {
+            changedProperties |= NET::WMGeometry;
+        }
+    }
+    if ((properties & NET::WMName) && windowInfo.name != fetchedWindowInfo.name) {
+        windowInfo.name = fetchedWindowInfo.name;
+        windowInfo.updateShortName();
+        changedProperties |= NET::WMName;
+    }
+
+    if (!changedProperties) {
+        it.value() = windowInfo;
+        return;
+    }
+
+    bool occupancyAffected = windowInfo.desktop != it.value().desktop ||
+                             windowInfo.isIgnored() != it.value().isIgnored();
+
+    if (occupancyAffected) {
+        removeFromBucket(it.value());
+        insertIntoBucket(windowInfo);
+    }
+    it.value() = windowInfo;
+
+    if (occupancyAffected) {
+        emit occupancyChanged();
+    } else if (!windowInfo.isIgnored()) {
+        emit windowInfoChanged(changedProperties);
+    }
+    emit windowUpdated(id, changedProperties);
+}
+
+void WindowIndex::insertIntoBucket(const WindowInfo& windowInfo) {
+    if (!windowInfo.isIgnored()) {
+        desktopBuckets[windowInfo.desktop].insert(windowInfo.id);
+    }
+}
+
+void WindowIndex::removeFromBucket(const WindowInfo& windowInfo) {
+    auto it = desktopBuckets.find(windowInfo.desktop);
+    if (it != desktopBuckets.end()) {
+        it.value().remove(windowInfo.id);
+        if (it.value().isEmpty()) {
+            desktopBuckets.erase(it);
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QRect>
+#include <QScreen>
+#include <QSet>
+
+#include <netwm_def.h>
+
+#include "WindowInfo.hpp"
+#include "WindowSnapshot.hpp"
+#include "WindowSystemBackend.hpp"
+
+class WindowIndex : public QObject {
+    Q_OBJECT
+
+public:
+    WindowIndex(WindowSystemBackend* backend, QObject* parent = nullptr);
+
+    static const NET::Properties trackedProperties;
+
+    // The index stays empty until it's built for the first time, which
+    // happens in the background and is announced by the rebuilt signal
+    void rebuild();
+
+    const WindowInfo* getWindowInfo(WId id) const;
+    QList<WindowInfo> getWindowInfoList(int desktopNumber) const;
+    bool isDesktopEmpty(int desktopNumber, bool includeSticky = true) const;
+
+    // Finds the screen matching the given geometry, or overlapping it the most
+    int getScreenIndex(const QRect& screenGeometry) const;
+
+signals:
+    void rebuilt();
+    void occupancyChanged();
+    void screensChanged();
+
+    // Geometry is only reported when the window changes its screens
+    void windowInfoChanged(NET::Properties properties);
+
+    // Reported for every window, ignored ones too, with properties
+    // that changed, or all of them when the window is new
+    void windowUpdated(WId id, NET::Properties properties);
+
+private:
+    WindowSystemBackend* backend;
+
+    QHash<WId, WindowInfo> windowInfoMap;
+    QHash<int, QSet<WId>> desktopBuckets;
+
+    QList<QRect> screenGeometryList;
+
+    // Windows which changed while a snapshot was being built are known
+    // better than the snapshot knows them, so they are left as they are
+    bool rebuildPending;
+    QSet<WId> windowsChangedDuringRebuild;
+    void markChangedDuringRebuild(WId id);
+    void applySnapshot(const WindowSnapshot& snapshot);
+
+    // Position of each window in the stacking order, from the bottom,
+    // worked out again at most once per change of the order
+    mutable QHash<WId, int> stackingRanks;
+    mutable bool stackingRanksOutdated;
+    void updateStackingRanks() const;
+
+    void setUpSignals();
+    void setUpScreenSignals(QScreen* screen);
+    void updateScreenGeometryList();
+    void updateScreenMask(WindowInfo& windowInfo) const;
+
+    void addWindow(WId id);
+    void removeWindow(WId id);
+    void updateWindow(WId id, NET::Properties properties);
+
+    void insertIntoBucket(const WindowInfo& windowInfo);
+    void removeFromBucket(const WindowInfo& windowInfo);
+};
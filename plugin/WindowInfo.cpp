@@ -0,0 +1,29 @@
+#include "WindowInfo.hpp"
+
+bool WindowInfo::hasState(NET::States flags) const {
+    return (state & flags) == flags;
+}
+
+bool WindowInfo::isOnScreen(int screenIndex) const {
+    return screenIndex >= 0 && screenIndex < 32 && (screenMask & (1u << screenIndex));
+}
+
+bool WindowInfo::isIgnored() const {
+    if (hasState(NET::SkipPager) || hasState(NET::SkipTaskbar)) {
+        return true;
+    }
+
+    return type == NET::Dock || type == NET::Desktop;
+}
+
+void WindowInfo::updateShortName() {
+    int separatorPosition = qMax(name.lastIndexOf(" - "),
+                                 qMax(name.lastIndexOf(" – "),
+                                      name.lastIndexOf(" — ")));
+    if (separatorPosition < 0) {
+        shortName = name;
+        return;
+    }
+
+    shortName = name.mid(separatorPosition + 3).trimmed();
+}
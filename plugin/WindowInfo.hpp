@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QRect>
+#include <QString>
+#include <qwindowdefs.h>
+
+#include <netwm_def.h>
+
+class WindowInfo {
+public:
+    WId id = 0;
+    int desktop = 0;
+    NET::States state;
+    NET::WindowType type = NET::Unknown;
+    QRect geometry;
+    QString name;
+
+    // Name without the document part, e.g. "Firefox" from "Page - Firefox",
+    // kept up to date by the window index as the name changes
+    QString shortName;
+
+    // Class part of WM_CLASS, fetched along with the type,
+    // as neither of them changes once the window is mapped
+    QString windowClass;
+
+    // Bit N is set when at least half of the window is on screen N
+    quint32 screenMask = 0;
+
+    bool hasState(NET::States flags) const;
+    bool isOnScreen(int screenIndex) const;
+
+    // Windows like docks, desktops or ones skipping the pager
+    // never make a desktop occupied
+    bool isIgnored() const;
+
+    void updateShortName();
+};
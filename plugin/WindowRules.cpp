@@ -0,0 +1,148 @@
+#include "WindowRules.hpp"
+
+#include <algorithm>
+
+bool WindowRules::Actions::isEmpty() const {
+    return desktop == 0 && !pin && !renameDesktop;
+}
+
+void WindowRules::compile(const QStringList& ruleStringList) {
+    ruleList.clear();
+    ruleIndexesByClass.clear();
+    ruleIndexesByType.clear();
+    otherRuleIndexes.clear();
+    appliedRuleIndexes.clear();
+
+    for (auto& ruleString : ruleStringList) {
+        Rule rule;
+        if (!parseRule(ruleString, rule)) {
+            qWarning("Ignoring invalid window rule: %s", qPrintable(ruleString));
+            continue;
+        }
+
+        int ruleIndex = ruleList.size();
+        ruleList << rule;
+
+        if (!rule.windowClass.isEmpty()) {
+            ruleIndexesByClass[rule.windowClass] << ruleIndex;
+        } else if (rule.type != NET::Unknown) {
+            ruleIndexesByType[rule.type] << ruleIndex;
+        } else {
+            otherRuleIndexes << ruleIndex;
+        }
+    }
+}
+
+bool WindowRules::isEmpty() const {
+    return ruleList.isEmpty();
+}
+
+WindowRules::Actions WindowRules::evaluate(const WindowInfo& windowInfo) {
+    Actions actions;
+    if (ruleList.isEmpty()) {
+        return actions;
+    }
+
+    QVector<int> ruleIndexes = ruleIndexesByClass.value(windowInfo.windowClass.toLower());
+    ruleIndexes << ruleIndexesByType.value(windowInfo.type);
+    ruleIndexes << otherRuleIndexes;
+
+    // Rules are applied in the order they were written in
+    std::sort(ruleIndexes.begin(), ruleIndexes.end());
+
+    auto& appliedIndexes = appliedRuleIndexes[windowInfo.id];
+    for (int ruleIndex : ruleIndexes) {
+        auto& rule = ruleList[ruleIndex];
+        if (appliedIndexes.contains(ruleIndex) || !rule.matches(windowInfo)) {
+            continue;
+        }
+        appliedIndexes.insert(ruleIndex);
+
+        if (actions.desktop == 0) {
+            actions.desktop = rule.actions.desktop;
+        }
+        actions.pin = actions.pin || rule.actions.pin;
+        actions.renameDesktop = actions.renameDesktop || rule.actions.renameDesktop;
+    }
+
+    if (appliedIndexes.isEmpty()) {
+        appliedRuleIndexes.remove(windowInfo.id);
+    }
+
+    return actions;
+}
+
+void WindowRules::forgetWindow(WId id) {
+    appliedRuleIndexes.remove(id);
+}
+
+bool WindowRules::Rule::matches(const WindowInfo& windowInfo) const {
+    if (!windowClass.isEmpty() && windowInfo.windowClass.toLower() != windowClass) {
+        return false;
+    }
+    if (type != NET::Unknown && windowInfo.type != type) {
+        return false;
+    }
+    if (!titlePattern.pattern().isEmpty() && !titlePattern.match(windowInfo.name).hasMatch()) {
+        return false;
+    }
+    return true;
+}
+
+bool WindowRules::parseRule(const QString& ruleString, Rule& rule) {
+    bool hasCondition = false;
+
+    for (auto& part : ruleString.split(';', QString::SkipEmptyParts)) {
+        int i = part.indexOf('=');
+        QString key = part.left(i).trimmed();
+        QString value = i >= 0 ? part.mid(i + 1).trimmed() : QString();
+
+        if (key == "class" && !value.isEmpty()) {
+            rule.windowClass = value.toLower();
+            hasCondition = true;
+        } else if (key == "type") {
+            rule.type = parseWindowType(value);
+            if (rule.type == NET::Unknown) {
+                return false;
+            }
+            hasCondition = true;
+        } else if (key == "title" && !value.isEmpty()) {
+            rule.titlePattern.setPattern(value);
+            rule.titlePattern.optimize();
+            if (!rule.titlePattern.isValid()) {
+                return false;
+            }
+            hasCondition = true;
+        } else if (key == "desktop") {
+            bool ok;
+            rule.actions.desktop = value.toInt(&ok);
+            if (!ok || rule.actions.desktop < 1) {
+                return false;
+            }
+        } else if (key == "pin" && i < 0) {
+            rule.actions.pin = true;
+        } else if (key == "rename" && i < 0) {
+            rule.actions.renameDesktop = true;
+        } else {
+            return false;
+        }
+    }
+
+    return hasCondition && !rule.actions.isEmpty();
+}
+
+NET::WindowType WindowRules::parseWindowType(const QString& typeName) {
+    static const QHash<QString, NET::WindowType> windowTypeByName = {
+        { "normal", NET::Normal },
+        { "desktop", NET::Desktop },
+        { "dock", NET::Dock },
+        { "toolbar", NET::Toolbar },
+        { "menu", NET::Menu },
+        { "dialog", NET::Dialog },
+        { "utility", NET::Utility },
+        { "splash", NET::Splash },
+        { "notification", NET::Notification }
+    };
+
+    return windowTypeByName.value(typeName.toLower(), NET::Unknown);
+}
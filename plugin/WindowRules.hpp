@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QRegularExpression>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "WindowInfo.hpp"
+
+// Rules moving windows to desktops, pinning them or naming their desktops.
+// Each rule is a list of conditions and actions separated by semicolons,
+// e.g. "class=firefox;title=YouTube$;desktop=2", where the title is a regex,
+// "type" is one of normal, dialog, utility etc., "pin" puts the window
+// on all desktops and "rename" names its desktop after the window's class
+class WindowRules {
+public:
+    class Actions {
+    public:
+        int desktop = 0;
+        bool pin = false;
+        bool renameDesktop = false;
+
+        bool isEmpty() const;
+    };
+
+    void compile(const QStringList& ruleStringList);
+    bool isEmpty() const;
+
+    // Rules are only looked up by the window's class and type, or tried when
+    // matching titles alone, and each rule is applied to a window only once
+    Actions evaluate(const WindowInfo& windowInfo);
+    void forgetWindow(WId id);
+
+private:
+    class Rule {
+    public:
+        QString windowClass;
+        NET::WindowType type = NET::Unknown;
+        QRegularExpression titlePattern;
+        Actions actions;
+
+        bool matches(const WindowInfo& windowInfo) const;
+    };
+
+    QVector<Rule> ruleList;
+
+    QHash<QString, QVector<int>> ruleIndexesByClass;
+    QHash<int, QVector<int>> ruleIndexesByType;
+    QVector<int> otherRuleIndexes;
+
+    QHash<WId, QSet<int>> appliedRuleIndexes;
+
+    static bool parseRule(const QString& ruleString, Rule& rule);
+    static NET::WindowType parseWindowType(const QString& typeName);
+};
@@ -0,0 +1,23 @@
+#include "WindowSnapshot.hpp"
+
+WindowSnapshot::WindowSnapshot() {}
+
+WindowSnapshot::WindowSnapshot(quint64 serial, const QList<WindowInfo>& windowInfoList) {
+    auto data = new Data();
+    data->serial = serial;
+    data->windowInfoList = windowInfoList;
+    d = data;
+}
+
+bool WindowSnapshot::isValid() const {
+    return d.constData() != nullptr;
+}
+
+quint64 WindowSnapshot::getSerial() const {
+    return d ? d->serial : 0;
+}
+
+const QList<WindowInfo>& WindowSnapshot::getWindowInfoList() const {
+    static const QList<WindowInfo> emptyList;
+    return d ? d->windowInfoList : emptyList;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QExplicitlySharedDataPointer>
+#include <QList>
+#include <QMetaType>
+#include <QSharedData>
+
+#include "WindowInfo.hpp"
+
+// All windows at one moment, built off the GUI thread and passed around
+// by value, which only copies a pointer since nothing can change it
+class WindowSnapshot {
+public:
+    WindowSnapshot();
+    WindowSnapshot(quint64 serial, const QList<WindowInfo>& windowInfoList);
+
+    bool isValid() const;
+
+    // Serials grow with every request, so the newest snapshot is known
+    quint64 getSerial() const;
+    const QList<WindowInfo>& getWindowInfoList() const;
+
+private:
+    class Data : public QSharedData {
+    public:
+        quint64 serial = 0;
+        QList<WindowInfo> windowInfoList;
+    };
+
+    QExplicitlySharedDataPointer<const Data> d;
+};
+
+Q_DECLARE_METATYPE(WindowSnapshot)
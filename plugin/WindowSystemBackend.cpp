@@ -0,0 +1,26 @@
+#include "WindowSystemBackend.hpp"
+
+#include <QTimer>
+
+#include "SimulatedBackend.hpp"
+#include "X11Backend.hpp"
+
+WindowSystemBackend::WindowSystemBackend(QObject* parent) : QObject(parent),
+        latestSnapshotSerial(0) {}
+
+WindowSystemBackend* WindowSystemBackend::create(QObject* parent) {
+    if (qgetenv("VIRTUALDESKTOPBAR_BACKEND") == "simulated") {
+        return new SimulatedBackend(parent);
+    }
+    return new X11Backend(parent);
+}
+
+void WindowSystemBackend::requestSnapshot() {
+    quint64 serial = ++latestSnapshotSerial;
+
+    QTimer::singleShot(0, this, [=] {
+        if (serial == latestSnapshotSerial) {
+            emit snapshotReady(WindowSnapshot(serial, fetchWindowInfoList(windows())));
+        }
+    });
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <qwindowdefs.h>
+
+#include <netwm_def.h>
+
+#include "WindowInfo.hpp"
+#include "WindowSnapshot.hpp"
+
+// Everything the applet needs from the window system, so that the logic
+// built on top of it can run against the real session or a simulated one
+class WindowSystemBackend : public QObject {
+    Q_OBJECT
+
+public:
+    WindowSystemBackend(QObject* parent = nullptr);
+
+    // Picks the simulator when VIRTUALDESKTOPBAR_BACKEND is "simulated"
+    static WindowSystemBackend* create(QObject* parent = nullptr);
+
+    // Whether KWin's D-Bus interface belongs to the same session
+    virtual bool isLiveSession() const = 0;
+
+    virtual int numberOfDesktops() const = 0;
+    virtual int currentDesktop() const = 0;
+    virtual QString desktopName(int number) const = 0;
+
+    virtual QList<WId> windows() const = 0;
+    virtual QList<WId> stackingOrder() const = 0;
+    virtual WId activeWindow() const = 0;
+
+    // Only the requested properties are filled in, and nothing at all
+    // is when the window doesn't exist anymore
+    virtual bool fetchWindowInfo(WId id, NET::Properties properties, WindowInfo& windowInfo) = 0;
+    virtual QList<WindowInfo> fetchWindowInfoList(const QList<WId>& ids) = 0;
+
+    // All windows are reported later by snapshotReady, and only the newest
+    // request is answered; by default the snapshot is built on this thread
+    virtual void requestSnapshot();
+
+    virtual void setNumberOfDesktops(int number) = 0;
+    virtual void setCurrentDesktop(int number) = 0;
+    virtual void setDesktopName(int number, const QString& name) = 0;
+    virtual void setOnDesktop(WId id, int number) = 0;
+
+signals:
+    void numberOfDesktopsChanged(int number);
+    void currentDesktopChanged(int number);
+    void desktopNamesChanged();
+
+    void windowAdded(WId id);
+    void windowRemoved(WId id);
+    void windowChanged(WId id, NET::Properties properties);
+    void stackingOrderChanged();
+
+    void snapshotReady(WindowSnapshot snapshot);
+
+protected:
+    quint64 latestSnapshotSerial;
+};
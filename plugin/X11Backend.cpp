@@ -0,0 +1,164 @@
+#include "X11Backend.hpp"
+
+#include <QX11Info>
+
+#include <KWindowInfo>
+#include <KWindowSystem>
+
+#include "SnapshotWorker.hpp"
+#include "Statistics.hpp"
+
+X11Backend::X11Backend(QObject* parent) : WindowSystemBackend(parent),
+        windowFetcher(QX11Info::connection(), QX11Info::appRootWindow()),
+        snapshotWorker(new SnapshotWorker()) {
+
+    qRegisterMetaType<WindowSnapshot>();
+
+    snapshotWorker->moveToThread(&snapshotThread);
+    QObject::connect(&snapshotThread, &QThread::finished, snapshotWorker, &QObject::deleteLater);
+    QObject::connect(this, &X11Backend::snapshotRequested, snapshotWorker, &SnapshotWorker::build);
+
+    // Snapshots finished after a newer request was made are dropped
+    QObject::connect(snapshotWorker, &SnapshotWorker::snapshotBuilt, this, [&](WindowSnapshot snapshot) {
+        if (snapshot.getSerial() == latestSnapshotSerial) {
+            emit snapshotReady(snapshot);
+        } else {
+            Statistics::get().increment(Statistics::SnapshotsSuperseded);
+        }
+    });
+
+    // Without a connection of its own the worker is no help, so the snapshot
+    // is built on this thread instead, through the shared connection
+    QObject::connect(snapshotWorker, &SnapshotWorker::snapshotFailed, this, [&](quint64 serial) {
+        if (serial == latestSnapshotSerial) {
+            WindowSystemBackend::requestSnapshot();
+        }
+    });
+
+    snapshotThread.setObjectName("VirtualDesktopBarSnapshots");
+    snapshotThread.start();
+
+    setUpSignals();
+}
+
+X11Backend::~X11Backend() {
+    snapshotThread.quit();
+    snapshotThread.wait();
+}
+
+bool X11Backend::isLiveSession() const {
+    return true;
+}
+
+int X11Backend::numberOfDesktops() const {
+    return KWindowSystem::numberOfDesktops();
+}
+
+int X11Backend::currentDesktop() const {
+    return KWindowSystem::currentDesktop();
+}
+
+QString X11Backend::desktopName(int number) const {
+    return KWindowSystem::desktopName(number);
+}
+
+QList<WId> X11Backend::windows() const {
+    return KWindowSystem::windows();
+}
+
+QList<WId> X11Backend::stackingOrder() const {
+    return KWindowSystem::stackingOrder();
+}
+
+WId X11Backend::activeWindow() const {
+    return KWindowSystem::activeWindow();
+}
+
+bool X11Backend::fetchWindowInfo(WId id, NET::Properties properties, WindowInfo& windowInfo) {
+    Statistics::get().increment(Statistics::WindowInfoFetches);
+
+    NET::Properties2 properties2;
+    if (properties & NET::WMWindowType) {
+        properties2 |= NET::WM2WindowClass;
+    }
+
+    KWindowInfo kWindowInfo(id, properties, properties2);
+    if (!kWindowInfo.valid()) {
+        return false;
+    }
+
+    windowInfo.id = id;
+    if (properties & NET::WMDesktop) {
+        windowInfo.desktop = kWindowInfo.desktop();
+    }
+    if (properties & NET::WMState) {
+        windowInfo.state = kWindowInfo.state();
+    }
+    if (properties & NET::WMWindowType) {
+        windowInfo.type = kWindowInfo.windowType(NET::AllTypesMask);
+        windowInfo.windowClass = QString::fromLocal8Bit(kWindowInfo.windowClassClass());
+    }
+    if (properties & NET::WMGeometry) {
+        windowInfo.geometry = kWindowInfo.geometry();
+    }
+    if (properties & NET::WMName) {
+        windowInfo.name = kWindowInfo.name();
+    }
+
+    return true;
+}
+
+QList<WindowInfo> X11Backend::fetchWindowInfoList(const QList<WId>& ids) {
+    Statistics::get().increment(Statistics::WindowListFetches);
+    return windowFetcher.fetch(ids);
+}
+
+void X11Backend::requestSnapshot() {
+    quint64 serial = ++latestSnapshotSerial;
+    snapshotWorker->supersede(serial);
+    emit snapshotRequested(serial);
+}
+
+void X11Backend::setNumberOfDesktops(int number) {
+    if (!netRootInfo) {
+        netRootInfo.reset(new NETRootInfo(QX11Info::connection(), 0));
+    }
+    netRootInfo->setNumberOfDesktops(number);
+}
+
+void X11Backend::setCurrentDesktop(int number) {
+    KWindowSystem::setCurrentDesktop(number);
+}
+
+void X11Backend::setDesktopName(int number, const QString& name) {
+    KWindowSystem::setDesktopName(number, name);
+}
+
+void X11Backend::setOnDesktop(WId id, int number) {
+    KWindowSystem::setOnDesktop(id, number);
+}
+
+void X11Backend::setUpSignals() {
+    QObject::connect(KWindowSystem::self(), &KWindowSystem::numberOfDesktopsChanged,
+                     this, &WindowSystemBackend::numberOfDesktopsChanged);
+
+    QObject::connect(KWindowSystem::self(), &KWindowSystem::currentDesktopChanged,
+                     this, &WindowSystemBackend::currentDesktopChanged);
+
+    QObject::connect(KWindowSystem::self(), &KWindowSystem::desktopNamesChanged,
+                     this, &WindowSystemBackend::desktopNamesChanged);
+
+    QObject::connect(KWindowSystem::self(), &KWindowSystem::windowAdded,
+                     this, &WindowSystemBackend::windowAdded);
+
+    QObject::connect(KWindowSystem::self(), &KWindowSystem::windowRemoved,
+                     this, &WindowSystemBackend::windowRemoved);
+
+    QObject::connect(KWindowSystem::self(), &KWindowSystem::stackingOrderChanged,
+                     this, &WindowSystemBackend::stackingOrderChanged);
+
+    QObject::connect(KWindowSystem::self(), static_cast<void (KWindowSystem::*)(WId, NET::Properties, NET::Properties2)>
+                                            (&KWindowSystem::windowChanged), this, [&](WId id, NET::Properties properties, NET::Properties2) {
+        emit windowChanged(id, properties);
+    });
+}
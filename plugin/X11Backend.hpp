@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QScopedPointer>
+#include <QThread>
+
+#include <netwm.h>
+
+#include "WindowSystemBackend.hpp"
+#include "XcbWindowFetcher.hpp"
+
+class SnapshotWorker;
+
+class X11Backend : public WindowSystemBackend {
+    Q_OBJECT
+
+public:
+    X11Backend(QObject* parent = nullptr);
+    ~X11Backend();
+
+    virtual bool isLiveSession() const override;
+
+    virtual int numberOfDesktops() const override;
+    virtual int currentDesktop() const override;
+    virtual QString desktopName(int number) const override;
+
+    virtual QList<WId> windows() const override;
+    virtual QList<WId> stackingOrder() const override;
+    virtual WId activeWindow() const override;
+
+    virtual bool fetchWindowInfo(WId id, NET::Properties properties, WindowInfo& windowInfo) override;
+    virtual QList<WindowInfo> fetchWindowInfoList(const QList<WId>& ids) override;
+    virtual void requestSnapshot() override;
+
+    virtual void setNumberOfDesktops(int number) override;
+    virtual void setCurrentDesktop(int number) override;
+    virtual void setDesktopName(int number, const QString& name) override;
+    virtual void setOnDesktop(WId id, int number) override;
+
+signals:
+    void snapshotRequested(quint64 serial);
+
+private:
+    // Created when first needed, as it asks the X server for its state
+    QScopedPointer<NETRootInfo> netRootInfo;
+    XcbWindowFetcher windowFetcher;
+
+    QThread snapshotThread;
+    SnapshotWorker* snapshotWorker;
+
+    void setUpSignals();
+};
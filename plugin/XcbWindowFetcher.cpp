@@ -0,0 +1,289 @@
+#include "XcbWindowFetcher.hpp"
+
+#include <cstdlib>
+
+#include <QByteArray>
+#include <QString>
+
+namespace {
+
+class WindowCookies {
+public:
+    xcb_get_property_cookie_t desktop;
+    xcb_get_property_cookie_t state;
+    xcb_get_property_cookie_t type;
+    xcb_get_property_cookie_t transientFor;
+    xcb_get_property_cookie_t netName;
+    xcb_get_property_cookie_t name;
+    xcb_get_property_cookie_t windowClass;
+    xcb_get_geometry_cookie_t geometry;
+    xcb_translate_coordinates_cookie_t position;
+};
+
+// Replies are allocated by XCB, so they have to be freed
+template <typename T>
+class XcbReply {
+public:
+    explicit XcbReply(T* reply) : reply(reply) {}
+    ~XcbReply() { free(reply); }
+    XcbReply(const XcbReply&) = delete;
+    XcbReply& operator=(const XcbReply&) = delete;
+
+    T* get() const { return reply; }
+    T* operator->() const { return reply; }
+    explicit operator bool() const { return reply != nullptr; }
+
+private:
+    T* reply;
+};
+
+}
+
+XcbWindowFetcher::XcbWindowFetcher(xcb_connection_t* connection, xcb_window_t rootWindow) :
+        connection(connection),
+        rootWindow(rootWindow),
+        atomsInterned(false),
+        utf8StringAtom(XCB_ATOM_NONE),
+        netWmNameAtom(XCB_ATOM_NONE),
+        netWmDesktopAtom(XCB_ATOM_NONE),
+        netWmStateAtom(XCB_ATOM_NONE),
+        netWmWindowTypeAtom(XCB_ATOM_NONE) {}
+
+QList<WindowInfo> XcbWindowFetcher::fetch(const QList<WId>& windowIds) {
+    QList<WindowInfo> windowInfoList;
+    if (!connection) {
+        return windowInfoList;
+    }
+
+    if (!atomsInterned) {
+        internAtoms();
+        atomsInterned = true;
+    }
+
+    // Sending all the requests first...
+    QVector<WindowCookies> cookiesList(windowIds.length());
+    for (int i = 0; i < windowIds.length(); i++) {
+        auto id = xcb_window_t(windowIds[i]);
+        auto& cookies = cookiesList[i];
+
+        cookies.desktop = xcb_get_property(connection, 0, id, netWmDesktopAtom, XCB_ATOM_CARDINAL, 0, 1);
+        cookies.state = xcb_get_property(connection, 0, id, netWmStateAtom, XCB_ATOM_ATOM, 0, 32);
+        cookies.type = xcb_get_property(connection, 0, id, netWmWindowTypeAtom, XCB_ATOM_ATOM, 0, 32);
+        cookies.transientFor = xcb_get_property(connection, 0, id, XCB_ATOM_WM_TRANSIENT_FOR, XCB_ATOM_WINDOW, 0, 1);
+        cookies.netName = xcb_get_property(connection, 0, id, netWmNameAtom, utf8StringAtom, 0, 256);
+        cookies.name = xcb_get_property(connection, 0, id, XCB_ATOM_WM_NAME, XCB_GET_PROPERTY_TYPE_ANY, 0, 256);
+        cookies.windowClass = xcb_get_property(connection, 0, id, XCB_ATOM_WM_CLASS, XCB_ATOM_STRING, 0, 256);
+        cookies.geometry = xcb_get_geometry(connection, id);
+        cookies.position = xcb_translate_coordinates(connection, id, rootWindow, 0, 0);
+    }
+
+    // ...and then collecting the replies
+    for (int i = 0; i < windowIds.length(); i++) {
+        auto& cookies = cookiesList[i];
+        xcb_generic_error_t* error = nullptr;
+
+        XcbReply<xcb_get_property_reply_t> desktopReply(xcb_get_property_reply(connection, cookies.desktop, &error));
+        free(error);
+        XcbReply<xcb_get_property_reply_t> stateReply(xcb_get_property_reply(connection, cookies.state, &error));
+        free(error);
+        XcbReply<xcb_get_property_reply_t> typeReply(xcb_get_property_reply(connection, cookies.type, &error));
+        free(error);
+        XcbReply<xcb_get_property_reply_t> transientForReply(xcb_get_property_reply(connection, cookies.transientFor, &error));
+        free(error);
+        XcbReply<xcb_get_property_reply_t> netNameReply(xcb_get_property_reply(connection, cookies.netName, &error));
+        free(error);
+        XcbReply<xcb_get_property_reply_t> nameReply(xcb_get_property_reply(connection, cookies.name, &error));
+        free(error);
+        XcbReply<xcb_get_property_reply_t> windowClassReply(xcb_get_property_reply(connection, cookies.windowClass, &error));
+        free(error);
+        XcbReply<xcb_get_geometry_reply_t> geometryReply(xcb_get_geometry_reply(connection, cookies.geometry, &error));
+        free(error);
+        XcbReply<xcb_translate_coordinates_reply_t> positionReply(xcb_translate_coordinates_reply(connection, cookies.position, &error));
+        free(error);
+
+        // The window was destroyed in the meantime
+        if (!geometryReply) {
+            continue;
+        }
+
+        WindowInfo windowInfo;
+        windowInfo.id = windowIds[i];
+
+        if (desktopReply && xcb_get_property_value_length(desktopReply.get()) >= 4) {
+            auto desktop = *static_cast<uint32_t*>(xcb_get_property_value(desktopReply.get()));
+            windowInfo.desktop = desktop == 0xFFFFFFFF ? int(NET::OnAllDesktops) : int(desktop) + 1;
+        }
+
+        if (stateReply && stateReply->format == 32) {
+            auto atoms = static_cast<xcb_atom_t*>(xcb_get_property_value(stateReply.get()));
+            int length = xcb_get_property_value_length(stateReply.get()) / 4;
+            for (int j = 0; j < length; j++) {
+                auto it = stateByAtom.constFind(atoms[j]);
+                if (it != stateByAtom.constEnd()) {
+                    windowInfo.state |= it.value();
+                }
+            }
+        }
+
+        if (typeReply && typeReply->format == 32 && xcb_get_property_value_length(typeReply.get()) > 0) {
+            auto atoms = static_cast<xcb_atom_t*>(xcb_get_property_value(typeReply.get()));
+            int length = xcb_get_property_value_length(typeReply.get()) / 4;
+            for (int j = 0; j < length && windowInfo.type == NET::Unknown; j++) {
+                for (auto& windowTypeAtom : windowTypeAtomList) {
+                    if (windowTypeAtom.first == atoms[j]) {
+                        windowInfo.type = windowTypeAtom.second;
+                        break;
+                    }
+                }
+            }
+        } else {
+            // Without a type, KWindowInfo goes by the spec: transient
+            // windows are dialogs and the others are normal ones
+            bool isTransient = transientForReply && xcb_get_property_value_length(transientForReply.get()) >= 4 &&
+                               *static_cast<xcb_window_t*>(xcb_get_property_value(transientForReply.get())) != XCB_WINDOW_NONE;
+            windowInfo.type = isTransient ? NET::Dialog : NET::Normal;
+        }
+
+        if (netNameReply && xcb_get_property_value_length(netNameReply.get()) > 0) {
+            windowInfo.name = QString::fromUtf8(static_cast<const char*>(xcb_get_property_value(netNameReply.get())),
+                                                xcb_get_property_value_length(netNameReply.get()));
+        } else if (nameReply && xcb_get_property_value_length(nameReply.get()) > 0) {
+            windowInfo.name = QString::fromLocal8Bit(static_cast<const char*>(xcb_get_property_value(nameReply.get())),
+                                                     xcb_get_property_value_length(nameReply.get()));
+        }
+
+        // WM_CLASS holds the instance and the class, both null-terminated
+        if (windowClassReply && xcb_get_property_value_length(windowClassReply.get()) > 0) {
+            QByteArray value(static_cast<const char*>(xcb_get_property_value(windowClassReply.get())),
+                             xcb_get_property_value_length(windowClassReply.get()));
+            int separator = value.indexOf('\0');
+            if (separator >= 0) {
+                windowInfo.windowClass = QString::fromLocal8Bit(value.mid(separator + 1).constData());
+            }
+        }
+
+        windowInfo.geometry.setSize(QSize(geometryReply->width, geometryReply->height));
+        if (positionReply) {
+            windowInfo.geometry.moveTo(positionReply->dst_x, positionReply->dst_y);
+        }
+
+        windowInfoList << windowInfo;
+    }
+
+    return windowInfoList;
+}
+
+void XcbWindowFetcher::internAtoms() {
+    if (!connection) {
+        return;
+    }
+
+    // The same states KWindowInfo reports, so that a state fetched later
+    // through it doesn't look like a change
+    QList<QByteArray> stateAtomNames = {
+        "_NET_WM_STATE_MODAL",
+        "_NET_WM_STATE_STICKY",
+        "_NET_WM_STATE_MAXIMIZED_VERT",
+        "_NET_WM_STATE_MAXIMIZED_HORZ",
+        "_NET_WM_STATE_SHADED",
+        "_NET_WM_STATE_SKIP_TASKBAR",
+        "_NET_WM_STATE_SKIP_PAGER",
+        "_KDE_NET_WM_STATE_SKIP_SWITCHER",
+        "_NET_WM_STATE_HIDDEN",
+        "_NET_WM_STATE_FULLSCREEN",
+        "_NET_WM_STATE_ABOVE",
+        "_NET_WM_STATE_STAYS_ON_TOP",
+        "_NET_WM_STATE_BELOW",
+        "_NET_WM_STATE_DEMANDS_ATTENTION",
+        "_NET_WM_STATE_FOCUSED"
+    };
+    QList<NET::State> stateList = {
+        NET::Modal,
+        NET::Sticky,
+        NET::MaxVert,
+        NET::MaxHoriz,
+        NET::Shaded,
+        NET::SkipTaskbar,
+        NET::SkipPager,
+        NET::SkipSwitcher,
+        NET::Hidden,
+        NET::FullScreen,
+        NET::KeepAbove,
+        NET::KeepAbove,
+        NET::KeepBelow,
+        NET::DemandsAttention,
+        NET::Focused
+    };
+
+    QList<QByteArray> windowTypeAtomNames = {
+        "_NET_WM_WINDOW_TYPE_NORMAL",
+        "_NET_WM_WINDOW_TYPE_DESKTOP",
+        "_NET_WM_WINDOW_TYPE_DOCK",
+        "_NET_WM_WINDOW_TYPE_TOOLBAR",
+        "_NET_WM_WINDOW_TYPE_MENU",
+        "_NET_WM_WINDOW_TYPE_DIALOG",
+        "_NET_WM_WINDOW_TYPE_UTILITY",
+        "_NET_WM_WINDOW_TYPE_SPLASH",
+        "_NET_WM_WINDOW_TYPE_DROPDOWN_MENU",
+        "_NET_WM_WINDOW_TYPE_POPUP_MENU",
+        "_NET_WM_WINDOW_TYPE_TOOLTIP",
+        "_NET_WM_WINDOW_TYPE_NOTIFICATION",
+        "_NET_WM_WINDOW_TYPE_COMBO",
+        "_NET_WM_WINDOW_TYPE_DND",
+        "_KDE_NET_WM_WINDOW_TYPE_OVERRIDE"
+    };
+    QList<NET::WindowType> windowTypeList = {
+        NET::Normal,
+        NET::Desktop,
+        NET::Dock,
+        NET::Toolbar,
+        NET::Menu,
+        NET::Dialog,
+        NET::Utility,
+        NET::Splash,
+        NET::DropdownMenu,
+        NET::PopupMenu,
+        NET::Tooltip,
+        NET::Notification,
+        NET::ComboBox,
+        NET::DNDIcon,
+        NET::Override
+    };
+
+    QList<QByteArray> atomNames = {
+        "UTF8_STRING",
+        "_NET_WM_NAME",
+        "_NET_WM_DESKTOP",
+        "_NET_WM_STATE",
+        "_NET_WM_WINDOW_TYPE"
+    };
+    atomNames << stateAtomNames << windowTypeAtomNames;
+
+    // Interning atoms is pipelined the same way as fetching properties
+    QVector<xcb_intern_atom_cookie_t> cookies;
+    for (auto& atomName : atomNames) {
+        cookies << xcb_intern_atom(connection, 0, atomName.length(), atomName.constData());
+    }
+
+    QVector<xcb_atom_t> atoms;
+    for (auto& cookie : cookies) {
+        XcbReply<xcb_intern_atom_reply_t> reply(xcb_intern_atom_reply(connection, cookie, nullptr));
+        atoms << (reply ? reply->atom : xcb_atom_t(XCB_ATOM_NONE));
+    }
+
+    utf8StringAtom = atoms[0];
+    netWmNameAtom = atoms[1];
+    netWmDesktopAtom = atoms[2];
+    netWmStateAtom = atoms[3];
+    netWmWindowTypeAtom = atoms[4];
+
+    int offset = 5;
+    for (int i = 0; i < stateList.length(); i++) {
+        stateByAtom.insert(atoms[offset + i], stateList[i]);
+    }
+
+    offset += stateList.length();
+    for (int i = 0; i < windowTypeList.length(); i++) {
+        windowTypeAtomList << qMakePair(atoms[offset + i], windowTypeList[i]);
+    }
+}
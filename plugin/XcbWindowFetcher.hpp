@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QVector>
+
+#include <xcb/xcb.h>
+
+#include "WindowInfo.hpp"
+
+// Fetches properties of many windows at once, by sending all the requests
+// first and collecting the replies afterwards, instead of waiting
+// for a round trip per window like KWindowInfo does
+class XcbWindowFetcher {
+public:
+    XcbWindowFetcher(xcb_connection_t* connection, xcb_window_t rootWindow);
+
+    QList<WindowInfo> fetch(const QList<WId>& windowIds);
+
+private:
+    xcb_connection_t* connection;
+    xcb_window_t rootWindow;
+
+    // Atoms are interned on the first fetch, keeping the round trip
+    // away from the startup
+    bool atomsInterned;
+    xcb_atom_t utf8StringAtom;
+    xcb_atom_t netWmNameAtom;
+    xcb_atom_t netWmDesktopAtom;
+    xcb_atom_t netWmStateAtom;
+    xcb_atom_t netWmWindowTypeAtom;
+
+    QHash<xcb_atom_t, NET::State> stateByAtom;
+    QVector<QPair<xcb_atom_t, NET::WindowType>> windowTypeAtomList;
+
+    void internAtoms();
+};
@@ -0,0 +1,285 @@
+#include <QCoreApplication>
+#include <QGuiApplication>
+#include <QRect>
+#include <QSignalSpy>
+#include <QTest>
+
+#include "SimulatedBackend.hpp"
+#include "Statistics.hpp"
+#include "VirtualDesktopBar.hpp"
+#include "VirtualDesktopBarEngine.hpp"
+
+// As many desktops as a session may ever have, each one with 50 windows
+static const int numberOfDesktops = 100;
+static const int numberOfWindows = 5000;
+
+// Changes made at once, which should take only a few passes
+static const int burstSize = 200;
+
+static int countEmptyDesktops(const DesktopListModel* model) {
+    int count = 0;
+    for (auto& desktopInfo : model->getDesktopInfoList()) {
+        count += desktopInfo.isEmpty ? 1 : 0;
+    }
+    return count;
+}
+
+static int countUrgentDesktops(const DesktopListModel* model) {
+    int count = 0;
+    for (auto& desktopInfo : model->getDesktopInfoList()) {
+        count += desktopInfo.isUrgent ? 1 : 0;
+    }
+    return count;
+}
+
+// Every test gets a new engine and a new simulated session, and waits
+// for the window scan, which starts once the applet reports its buttons
+class EngineTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+
+    void refreshesAllDesktops();
+    void addsAndRemovesEmptyDesktops();
+    void renamesEmptyDesktops();
+    void followsWindowChanges();
+    void coalescesBurstsOfChanges();
+    void handsOverAutomation();
+    void movesDesktopsBeforeWindowScan();
+    void refreshesWindowNamesOnlyWhenShown();
+    void dropsCanceledDesktopMoves();
+};
+
+void EngineTest::cleanup() {
+    // The engine is deleted later, after the last applet is gone
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+}
+
+void EngineTest::refreshesAllDesktops() {
+    VirtualDesktopBar bar;
+    auto engine = VirtualDesktopBarEngine::getInstance();
+    QVERIFY(engine->getSimulatedBackend());
+
+    bar.reportDesktopButtonsPopulated(nullptr);
+    QTRY_VERIFY(engine->isStarted());
+
+    auto model = bar.getDesktopListModel();
+    QTRY_COMPARE(model->getCount(), numberOfDesktops);
+    QTRY_COMPARE(countEmptyDesktops(model), 0);
+
+    QVERIFY(model->getDesktopInfoList().first().isCurrent);
+    QCOMPARE(model->getDesktopInfoList().last().name, QString("Desktop %1").arg(numberOfDesktops));
+    QCOMPARE(bar.getWindowNameList(numberOfDesktops).length(), numberOfWindows / numberOfDesktops);
+}
+
+void EngineTest::addsAndRemovesEmptyDesktops() {
+    VirtualDesktopBar bar;
+    auto engine = VirtualDesktopBarEngine::getInstance();
+    auto backend = engine->getSimulatedBackend();
+    QVERIFY(backend);
+
+    bar.reportDesktopButtonsPopulated(nullptr);
+    QTRY_VERIFY(engine->isStarted());
+
+    auto model = bar.getDesktopListModel();
+    QTRY_COMPARE(model->getCount(), numberOfDesktops);
+    QTRY_COMPARE(countEmptyDesktops(model), 0);
+
+    // All desktops are occupied, so an empty one is added
+    bar.setProperty("cfg_DynamicDesktopsEnable", true);
+    QTRY_COMPARE(model->getCount(), numberOfDesktops + 1);
+    QVERIFY(model->getDesktopInfoList().last().isEmpty);
+
+    // Taking the empty desktop adds another one
+    WId id = backend->createWindow(numberOfDesktops + 1, QRect(0, 0, 800, 600), "Terminal");
+    QTRY_COMPARE(model->getCount(), numberOfDesktops + 2);
+
+    // Leaving it again removes all the empty desktops but one
+    backend->destroyWindow(id);
+    QTRY_COMPARE(model->getCount(), numberOfDesktops + 1);
+    QCOMPARE(countEmptyDesktops(model), 1);
+    QCOMPARE(backend->numberOfDesktops(), numberOfDesktops + 1);
+}
+
+void EngineTest::renamesEmptyDesktops() {
+    VirtualDesktopBar bar;
+    auto engine = VirtualDesktopBarEngine::getInstance();
+    auto backend = engine->getSimulatedBackend();
+    QVERIFY(backend);
+
+    bar.reportDesktopButtonsPopulated(nullptr);
+    QTRY_VERIFY(engine->isStarted());
+
+    auto model = bar.getDesktopListModel();
+    QTRY_COMPARE(model->getCount(), numberOfDesktops);
+    QTRY_COMPARE(countEmptyDesktops(model), 0);
+
+    bar.setProperty("cfg_EmptyDesktopsRenameAs", "Empty");
+    for (auto& windowInfo : engine->getWindowIndex().getWindowInfoList(numberOfDesktops)) {
+        backend->destroyWindow(windowInfo.id);
+    }
+
+    QTRY_COMPARE(model->getDesktopInfoList().last().name, QString("Empty"));
+    QVERIFY(model->getDesktopInfoList().last().isEmpty);
+    QCOMPARE(countEmptyDesktops(model), 1);
+    QCOMPARE(model->getDesktopInfoList().first().name, QString("Desktop 1"));
+}
+
+void EngineTest::followsWindowChanges() {
+    VirtualDesktopBar bar;
+    auto engine = VirtualDesktopBarEngine::getInstance();
+    auto backend = engine->getSimulatedBackend();
+    QVERIFY(backend);
+
+    bar.reportDesktopButtonsPopulated(nullptr);
+    QTRY_VERIFY(engine->isStarted());
+
+    auto model = bar.getDesktopListModel();
+    QTRY_COMPARE(model->getCount(), numberOfDesktops);
+
+    // New windows go on top of the stack
+    WId id = backend->createWindow(1, QRect(0, 0, 800, 600), "notes.txt - Editor");
+    QTRY_COMPARE(bar.getWindowNameList(1).first(), QString("Editor"));
+
+    // The first window of the session is on the first desktop
+    backend->activateWindow(1);
+    QTRY_COMPARE(bar.getWindowNameList(1).first(), QString("Application 0"));
+
+    backend->setWindowName(id, "todo.txt - Writer");
+    QTRY_VERIFY(bar.getWindowNameList(1).contains("Writer"));
+    QVERIFY(!bar.getWindowNameList(1).contains("Editor"));
+
+    backend->setWindowState(id, NET::DemandsAttention);
+    QTRY_VERIFY(model->getDesktopInfoList().first().isUrgent);
+    QCOMPARE(countUrgentDesktops(model), 1);
+
+    QRect geometry(100, 100, 400, 300);
+    backend->setWindowGeometry(id, geometry);
+    QTRY_COMPARE(engine->getWindowIndex().getWindowInfo(id)->geometry, geometry);
+}
+
+void EngineTest::coalescesBurstsOfChanges() {
+    VirtualDesktopBar bar;
+    auto engine = VirtualDesktopBarEngine::getInstance();
+    auto backend = engine->getSimulatedBackend();
+    QVERIFY(backend);
+
+    bar.reportDesktopButtonsPopulated(nullptr);
+    QTRY_VERIFY(engine->isStarted());
+
+    auto model = bar.getDesktopListModel();
+    QTRY_COMPARE(model->getCount(), numberOfDesktops);
+    QTRY_COMPARE(countEmptyDesktops(model), 0);
+
+    auto& changeScheduler = engine->getChangeScheduler();
+    quint64 executedCount = changeScheduler.getExecutedCount();
+
+    // Windows are numbered from 1, and go round the desktops
+    for (WId id = 1; id <= WId(burstSize); id++) {
+        backend->setWindowState(id, NET::DemandsAttention);
+    }
+
+    QTRY_COMPARE(countUrgentDesktops(model), numberOfDesktops);
+
+    quint64 passCount = changeScheduler.getExecutedCount() - executedCount;
+    QVERIFY(passCount > 0);
+    QVERIFY2(passCount < quint64(burstSize / 10), qPrintable(QString("%1 passes").arg(passCount)));
+    QVERIFY(changeScheduler.getCoalescedCount() > 0);
+}
+
+void EngineTest::handsOverAutomation() {
+    auto firstBar = new VirtualDesktopBar();
+    VirtualDesktopBar secondBar;
+    auto engine = VirtualDesktopBarEngine::getInstance();
+    QVERIFY(engine->isAutomationOwner(firstBar));
+
+    delete firstBar;
+    QVERIFY(engine->isAutomationOwner(&secondBar));
+
+    // Only the owner shows the rename popup
+    QSignalSpy spy(&secondBar, &VirtualDesktopBar::requestRenameCurrentDesktop);
+    emit engine->requestRenameCurrentDesktop();
+    QCOMPARE(spy.count(), 1);
+}
+
+void EngineTest::movesDesktopsBeforeWindowScan() {
+    VirtualDesktopBar bar;
+    auto engine = VirtualDesktopBarEngine::getInstance();
+    auto backend = engine->getSimulatedBackend();
+    QVERIFY(backend);
+
+    // The move starts the window scan by itself
+    bar.moveDesktop(1, 2);
+    QVERIFY(!engine->isStarted());
+    QTRY_VERIFY(engine->isStarted());
+
+    QTRY_COMPARE(backend->desktopName(2), QString("Desktop 1"));
+    QCOMPARE(backend->desktopName(1), QString("Desktop 2"));
+
+    // The first window of the session goes along with its desktop
+    QTRY_COMPARE(engine->getWindowIndex().getWindowInfo(1)->desktop, 2);
+}
+
+void EngineTest::refreshesWindowNamesOnlyWhenShown() {
+    VirtualDesktopBar bar;
+    auto engine = VirtualDesktopBarEngine::getInstance();
+    auto backend = engine->getSimulatedBackend();
+    QVERIFY(backend);
+
+    bar.reportDesktopButtonsPopulated(nullptr);
+    QTRY_VERIFY(engine->isStarted());
+
+    auto triggerCount = [] {
+        return Statistics::get().getCounters().value("triggersFromWindowInfo").toULongLong();
+    };
+    quint64 initialTriggerCount = triggerCount();
+
+    backend->setWindowName(1, "Renamed - Application 0");
+    QTRY_COMPARE(engine->getWindowIndex().getWindowInfo(1)->name, QString("Renamed - Application 0"));
+    QCOMPARE(triggerCount(), initialTriggerCount);
+
+    // Labels of style 3 show the active window's name
+    bar.setProperty("cfg_DesktopLabelsStyle", 3);
+    backend->setWindowName(1, "Renamed again - Application 0");
+    QTRY_COMPARE(triggerCount(), initialTriggerCount + 1);
+}
+
+void EngineTest::dropsCanceledDesktopMoves() {
+    VirtualDesktopBar bar;
+    auto engine = VirtualDesktopBarEngine::getInstance();
+    auto backend = engine->getSimulatedBackend();
+    QVERIFY(backend);
+
+    bar.reportDesktopButtonsPopulated(nullptr);
+    QTRY_VERIFY(engine->isStarted());
+
+    auto model = bar.getDesktopListModel();
+    QTRY_COMPARE(model->getCount(), numberOfDesktops);
+    QTRY_COMPARE(countEmptyDesktops(model), 0);
+
+    bar.previewMoveDesktop(1, 2);
+    QCOMPARE(model->getDesktopInfoList().first().name, QString("Desktop 2"));
+
+    bar.cancelMoveDesktop();
+    QCOMPARE(model->getDesktopInfoList().first().name, QString("Desktop 1"));
+
+    // Refreshes are no longer held back by the preview
+    backend->setWindowState(1, NET::DemandsAttention);
+    QTRY_VERIFY(model->getDesktopInfoList().first().isUrgent);
+    QCOMPARE(backend->desktopName(1), QString("Desktop 1"));
+}
+
+int main(int argc, char** argv) {
+    // Runs without a display, against the simulator only
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    qputenv("VIRTUALDESKTOPBAR_BACKEND", "simulated");
+    qputenv("VIRTUALDESKTOPBAR_SIMULATED_DESKTOPS", QByteArray::number(numberOfDesktops));
+    qputenv("VIRTUALDESKTOPBAR_SIMULATED_WINDOWS", QByteArray::number(numberOfWindows));
+
+    QGuiApplication app(argc, argv);
+    EngineTest test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "EngineTest.moc"
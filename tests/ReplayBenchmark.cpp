@@ -0,0 +1,157 @@
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QStringList>
+#include <QX11Info>
+
+#include <KWindowInfo>
+#include <KWindowSystem>
+
+#include "SimulatedBackend.hpp"
+#include "TraceReplayer.hpp"
+#include "VirtualDesktopBar.hpp"
+#include "VirtualDesktopBarEngine.hpp"
+#include "XcbWindowFetcher.hpp"
+
+// Every allocation of the process is counted, Qt's containers included,
+// by standing in for glibc's allocator, which operator new goes to as well
+static std::atomic<quint64> allocationCount(0);
+
+extern "C" {
+    void* __libc_malloc(std::size_t size);
+    void* __libc_calloc(std::size_t count, std::size_t size);
+    void* __libc_realloc(void* pointer, std::size_t size);
+
+    void* malloc(std::size_t size) noexcept {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(std::size_t count, std::size_t size) noexcept {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* pointer, std::size_t size) noexcept {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        return __libc_realloc(pointer, size);
+    }
+}
+
+// Takes snapshots of the windows of the running session, batched and
+// through KWindowInfo, and reports both times and any window they disagree on
+static int compareSnapshots(int rounds) {
+    if (!QX11Info::isPlatformX11()) {
+        qWarning("Comparing snapshots needs an X11 session");
+        return 1;
+    }
+
+    const NET::Properties properties = NET::WMState | NET::WMDesktop | NET::WMGeometry |
+                                       NET::WMWindowType | NET::WMName;
+
+    XcbWindowFetcher windowFetcher(QX11Info::connection(), QX11Info::appRootWindow());
+    QList<WId> ids = KWindowSystem::stackingOrder();
+
+    // The first fetch interns atoms, so it isn't timed
+    windowFetcher.fetch(ids);
+
+    qint64 batchedTime = 0;
+    qint64 kWindowInfoTime = 0;
+    QElapsedTimer timer;
+    for (int i = 0; i < rounds; i++) {
+        timer.start();
+        windowFetcher.fetch(ids);
+        batchedTime += timer.nsecsElapsed();
+
+        timer.start();
+        for (WId id : ids) {
+            KWindowInfo(id, properties, NET::WM2WindowClass).valid();
+        }
+        kWindowInfoTime += timer.nsecsElapsed();
+    }
+
+    int mismatchCount = 0;
+    for (auto& windowInfo : windowFetcher.fetch(ids)) {
+        KWindowInfo kWindowInfo(windowInfo.id, properties, NET::WM2WindowClass);
+        if (!kWindowInfo.valid()) {
+            continue;
+        }
+        if (windowInfo.desktop != kWindowInfo.desktop() ||
+            windowInfo.state != kWindowInfo.state() ||
+            windowInfo.type != kWindowInfo.windowType(NET::AllTypesMask) ||
+            windowInfo.geometry != kWindowInfo.geometry() ||
+            windowInfo.name != kWindowInfo.name() ||
+            windowInfo.windowClass != QString::fromLocal8Bit(kWindowInfo.windowClassClass())) {
+            qWarning("Window 0x%llx differs", quint64(windowInfo.id));
+            mismatchCount++;
+        }
+    }
+
+    qInfo("Snapshot of %d windows: %lld us batched, %lld us with KWindowInfo, %d differing",
+          ids.length(), batchedTime / rounds / 1000, kWindowInfoTime / rounds / 1000, mismatchCount);
+    return mismatchCount > 0 ? 1 : 0;
+}
+
+// Replays a recorded trace through an applet and the engine behind it,
+// on the simulator, and reports latencies, passes and allocations,
+// or compares the ways of taking snapshots on the running session
+int main(int argc, char** argv) {
+    if (argc >= 2 && std::strcmp(argv[1], "--compare-snapshots") == 0) {
+        QGuiApplication app(argc, argv);
+        return compareSnapshots(qMax(1, app.arguments().value(2, "10").toInt()));
+    }
+
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    qputenv("VIRTUALDESKTOPBAR_BACKEND", "simulated");
+    qunsetenv("VIRTUALDESKTOPBAR_RECORD_TRACE");
+    qunsetenv("VIRTUALDESKTOPBAR_REPLAY_TRACE");
+
+    QGuiApplication app(argc, argv);
+
+    auto arguments = app.arguments();
+    if (arguments.length() < 2) {
+        qWarning("Usage: bench_virtualdesktopbar TRACE_FILE [SPEED]\n"
+                 "       bench_virtualdesktopbar --compare-snapshots [ROUNDS]");
+        return 1;
+    }
+
+    // Replaying without pauses by default, as fast as the engine keeps up
+    QString filePath = arguments[1];
+    double speed = arguments.value(2, "0").toDouble();
+
+    VirtualDesktopBar bar;
+    auto engine = VirtualDesktopBarEngine::getInstance();
+    auto backend = engine->getSimulatedBackend();
+    if (!backend) {
+        qWarning("The simulated backend isn't available");
+        return 1;
+    }
+
+    TraceReplayer* replayer = nullptr;
+    quint64 initialAllocationCount = 0;
+
+    // The trace starts once windows are scanned, like it would in the panel
+    QObject::connect(&engine->getWindowIndex(), &WindowIndex::rebuilt, &app, [&] {
+        if (replayer) {
+            return;
+        }
+
+        replayer = new TraceReplayer(backend, &engine->getChangeScheduler(), filePath, speed, &app);
+        if (!replayer->isLoaded()) {
+            app.exit(1);
+            return;
+        }
+
+        initialAllocationCount = allocationCount.load();
+        QObject::connect(replayer, &TraceReplayer::finished, &app, [&] {
+            qInfo("Allocations: %llu", allocationCount.load() - initialAllocationCount);
+            app.quit();
+        });
+    });
+
+    bar.reportDesktopButtonsPopulated(nullptr);
+    return app.exec();
+}